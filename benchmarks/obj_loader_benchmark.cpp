@@ -0,0 +1,105 @@
+// Compares LveModel::Builder::loadModel (tinyobjloader) against the multi-threaded
+// loadModelParallel on a generated grid mesh.
+//
+// usage: ObjLoaderBenchmark [million triangles = 4] [threads = all]
+
+#include "lve_model.hpp"
+
+// std
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+void writeGridObj(const std::string &filepath, uint32_t gridSize) {
+  std::ofstream out{filepath};
+  if (!out.is_open()) {
+    throw std::runtime_error("failed to create benchmark file: " + filepath);
+  }
+
+  char line[128];
+  for (uint32_t y = 0; y <= gridSize; y++) {
+    for (uint32_t x = 0; x <= gridSize; x++) {
+      float u = static_cast<float>(x) / gridSize;
+      float v = static_cast<float>(y) / gridSize;
+      float height = 0.05f * std::sin(u * 40.f) * std::cos(v * 40.f);
+      std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", u - .5f, height, v - .5f);
+      out << line;
+      std::snprintf(line, sizeof(line), "vt %.6f %.6f\n", u, v);
+      out << line;
+    }
+  }
+  out << "vn 0.000000 -1.000000 0.000000\n";
+
+  for (uint32_t y = 0; y < gridSize; y++) {
+    for (uint32_t x = 0; x < gridSize; x++) {
+      uint32_t i = y * (gridSize + 1) + x + 1;
+      uint32_t j = i + gridSize + 1;
+      std::snprintf(
+          line,
+          sizeof(line),
+          "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n",
+          i,
+          i,
+          i + 1,
+          i + 1,
+          j + 1,
+          j + 1,
+          j,
+          j);
+      out << line;
+    }
+  }
+}
+
+template <typename F>
+double timeSeconds(F &&f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  f();
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  double millionTriangles = argc > 1 ? std::atof(argv[1]) : 4.0;
+  uint32_t threadCount = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 0;
+
+  // two triangles per grid cell
+  uint32_t gridSize = static_cast<uint32_t>(std::sqrt(millionTriangles * 1e6 / 2.0));
+  std::string filepath =
+      (std::filesystem::temp_directory_path() / "lve_obj_loader_benchmark.obj").string();
+
+  try {
+    std::cout << "generating " << gridSize << "x" << gridSize << " grid..." << std::endl;
+    writeGridObj(filepath, gridSize);
+    std::cout << "file size: " << std::filesystem::file_size(filepath) / (1024 * 1024) << " MiB"
+              << std::endl;
+
+    lve::LveModel::Builder serial{};
+    lve::LveModel::Builder parallel{};
+    double serialTime = timeSeconds([&]() { serial.loadModel(filepath); });
+    double parallelTime = timeSeconds([&]() { parallel.loadModelParallel(filepath, threadCount); });
+
+    bool identical = serial.vertices == parallel.vertices && serial.indices == parallel.indices;
+    std::cout << "vertices: " << parallel.vertices.size()
+              << ", triangles: " << parallel.indices.size() / 3 << std::endl;
+    std::cout << "tinyobjloader: " << serialTime << " s" << std::endl;
+    std::cout << "parallel:      " << parallelTime << " s (" << serialTime / parallelTime << "x)"
+              << std::endl;
+    std::cout << "output identical: " << (identical ? "yes" : "no") << std::endl;
+
+    std::filesystem::remove(filepath);
+    return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    std::filesystem::remove(filepath);
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,62 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec3 fragPosWorld;
+layout (location = 2) in vec3 fragNormalWorld;
+layout (location = 3) in vec2 fragUv;
+layout (location = 4) flat in uint fragTextureIndex;
+
+layout (location = 0) out vec4 outColor;
+
+struct PointLight {
+  vec4 position; // ignore w
+  vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+// LveBindlessDescriptors texture array
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+void main() {
+  vec3 surfaceColor = fragColor;
+  if (fragTextureIndex != 0xFFFFFFFFu) {
+    surfaceColor *= texture(textures[nonuniformEXT(fragTextureIndex)], fragUv).rgb;
+  }
+
+  vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+  vec3 specularLight = vec3(0.0);
+  vec3 surfaceNormal = normalize(fragNormalWorld);
+
+  vec3 cameraPosWorld = ubo.invView[3].xyz;
+  vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
+
+  for (int i = 0; i < ubo.numLights; i++) {
+    PointLight light = ubo.pointLights[i];
+    vec3 directionToLight = light.position.xyz - fragPosWorld;
+    float attenuation = 1.0 / dot(directionToLight, directionToLight); // distance squared
+    directionToLight = normalize(directionToLight);
+
+    float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
+    vec3 intensity = light.color.xyz * light.color.w * attenuation;
+
+    diffuseLight += intensity * cosAngIncidence;
+
+    // specular lighting
+    vec3 halfAngle = normalize(directionToLight + viewDirection);
+    float blinnTerm = dot(surfaceNormal, halfAngle);
+    blinnTerm = clamp(blinnTerm, 0, 1);
+    blinnTerm = pow(blinnTerm, 512.0); // higher values -> sharper highlight
+    specularLight += intensity * blinnTerm;
+  }
+  
+  outColor = vec4(diffuseLight * surfaceColor + specularLight * surfaceColor, 1.0);
+}
@@ -0,0 +1,64 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// LveModel::CompactVertex, positions are normalized to the model bounds and the object
+// model matrix includes the dequantize transform
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 octNormal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUv;
+layout(location = 4) flat out uint fragTextureIndex;
+
+struct PointLight {
+  vec4 position; // ignore w
+  vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+layout(push_constant) uniform Push {
+  uint objectIndex;
+  uint objectBufferIndex;
+} push;
+
+// LveBindlessDescriptors arrays, per object data is read from the buffer of this frame
+struct ObjectData {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  uint textureIndex;
+};
+
+layout(set = 1, binding = 1) readonly buffer ObjectBuffer {
+  ObjectData objects[];
+} objectBuffers[];
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+void main() {
+  ObjectData object = objectBuffers[push.objectBufferIndex].objects[push.objectIndex];
+  vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(object.normalMatrix) * decodeOctahedral(octNormal));
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color;
+  fragUv = uv;
+  fragTextureIndex = object.textureIndex;
+}
@@ -3,6 +3,8 @@
 #include "keyboard_movement_controller.hpp"
 #include "lve_buffer.hpp"
 #include "lve_camera.hpp"
+#include "lve_descriptor_allocator.hpp"
+#include "lve_frame_allocator.hpp"
 #include "systems/point_light_system.hpp"
 #include "systems/simple_render_system.hpp"
 
@@ -16,15 +18,21 @@
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <iostream>
 #include <stdexcept>
 
 namespace lve {
 
 FirstApp::FirstApp() {
+  if (lveDevice.supportsDescriptorIndexing()) {
+    bindlessDescriptors = std::make_unique<LveBindlessDescriptors>(lveDevice);
+  }
   globalPool =
       LveDescriptorPool::Builder(lveDevice)
           .setMaxSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(
+              VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+              LveSwapChain::MAX_FRAMES_IN_FLIGHT)
           .build();
   loadGameObjects();
 }
@@ -32,34 +40,27 @@ FirstApp::FirstApp() {
 FirstApp::~FirstApp() {}
 
 void FirstApp::run() {
-  std::vector<std::unique_ptr<LveBuffer>> uboBuffers(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-  for (int i = 0; i < uboBuffers.size(); i++) {
-    uboBuffers[i] = std::make_unique<LveBuffer>(
-        lveDevice,
-        sizeof(GlobalUbo),
-        1,
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-    uboBuffers[i]->map();
-  }
+  LveFrameAllocator frameAllocator{lveDevice};
+  LveDescriptorAllocator descriptorAllocator{lveDevice};
 
   auto globalSetLayout =
       LveDescriptorSetLayout::Builder(lveDevice)
-          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-          .build();
+          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
+          .build(layoutCache);
 
   std::vector<VkDescriptorSet> globalDescriptorSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
   for (int i = 0; i < globalDescriptorSets.size(); i++) {
-    auto bufferInfo = uboBuffers[i]->descriptorInfo();
+    auto bufferInfo = frameAllocator.descriptorInfo(i, sizeof(GlobalUbo));
     LveDescriptorWriter(*globalSetLayout, *globalPool)
         .writeBuffer(0, &bufferInfo)
-        .build(globalDescriptorSets[i]);
+        .build(globalDescriptorSets[i], descriptorSetCache);
   }
 
   SimpleRenderSystem simpleRenderSystem{
       lveDevice,
       lveRenderer.getSwapChainRenderPass(),
-      globalSetLayout->getDescriptorSetLayout()};
+      globalSetLayout->getDescriptorSetLayout(),
+      bindlessDescriptors.get()};
   PointLightSystem pointLightSystem{
       lveDevice,
       lveRenderer.getSwapChainRenderPass(),
@@ -71,14 +72,22 @@ void FirstApp::run() {
   KeyboardMovementController cameraController{};
 
   auto currentTime = std::chrono::high_resolution_clock::now();
+  float memoryReportTime = 0.f;
   while (!lveWindow.shouldClose()) {
     glfwPollEvents();
+    updatePendingModels();
 
     auto newTime = std::chrono::high_resolution_clock::now();
     float frameTime =
         std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
     currentTime = newTime;
 
+    memoryReportTime -= frameTime;
+    if (memoryReportTime <= 0.f) {
+      lveDevice.printMemoryReport(std::cout);
+      memoryReportTime = MEMORY_REPORT_INTERVAL;
+    }
+
     cameraController.moveInPlaneXZ(lveWindow.getGLFWwindow(), frameTime, viewerObject);
     camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
@@ -87,13 +96,19 @@ void FirstApp::run() {
 
     if (auto commandBuffer = lveRenderer.beginFrame()) {
       int frameIndex = lveRenderer.getFrameIndex();
+      // beginFrame waited for this frame's previous submission
+      frameAllocator.beginFrame(frameIndex);
+      descriptorAllocator.beginFrame(frameIndex);
       FrameInfo frameInfo{
           frameIndex,
           frameTime,
           commandBuffer,
           camera,
           globalDescriptorSets[frameIndex],
-          gameObjects};
+          gameObjects,
+          frameAllocator,
+          0,
+          descriptorAllocator};
 
       // update
       GlobalUbo ubo{};
@@ -101,8 +116,10 @@ void FirstApp::run() {
       ubo.view = camera.getView();
       ubo.inverseView = camera.getInverseView();
       pointLightSystem.update(frameInfo, ubo);
-      uboBuffers[frameIndex]->writeToBuffer(&ubo);
-      uboBuffers[frameIndex]->flush();
+      frameInfo.globalUboOffset = frameAllocator.write(ubo);
+
+      // compact memory before anything draws from the moved buffers
+      defragmenter.update(commandBuffer);
 
       // render
       lveRenderer.beginSwapChainRenderPass(commandBuffer);
@@ -112,6 +129,7 @@ void FirstApp::run() {
       pointLightSystem.render(frameInfo);
 
       lveRenderer.endSwapChainRenderPass(commandBuffer);
+      frameAllocator.flush();
       lveRenderer.endFrame();
     }
   }
@@ -119,25 +137,34 @@ void FirstApp::run() {
   vkDeviceWaitIdle(lveDevice.device());
 }
 
+void FirstApp::updatePendingModels() {
+  modelRegistry.update();
+  for (auto it = pendingModels.begin(); it != pendingModels.end();) {
+    if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++it;
+      continue;
+    }
+    gameObjects.at(it->first).model = it->second.get();
+    it = pendingModels.erase(it);
+  }
+}
+
 void FirstApp::loadGameObjects() {
-  std::shared_ptr<LveModel> lveModel =
-      LveModel::createModelFromFile(lveDevice, "models/flat_vase.obj");
+  // objects draw nothing until their model has been loaded and uploaded
   auto flatVase = LveGameObject::createGameObject();
-  flatVase.model = lveModel;
+  pendingModels.emplace_back(flatVase.getId(), modelRegistry.load("models/flat_vase.obj"));
   flatVase.transform.translation = {-.5f, .5f, 0.f};
   flatVase.transform.scale = {3.f, 1.5f, 3.f};
   gameObjects.emplace(flatVase.getId(), std::move(flatVase));
 
-  lveModel = LveModel::createModelFromFile(lveDevice, "models/smooth_vase.obj");
   auto smoothVase = LveGameObject::createGameObject();
-  smoothVase.model = lveModel;
+  pendingModels.emplace_back(smoothVase.getId(), modelRegistry.load("models/smooth_vase.obj"));
   smoothVase.transform.translation = {.5f, .5f, 0.f};
   smoothVase.transform.scale = {3.f, 1.5f, 3.f};
   gameObjects.emplace(smoothVase.getId(), std::move(smoothVase));
 
-  lveModel = LveModel::createModelFromFile(lveDevice, "models/quad.obj");
   auto floor = LveGameObject::createGameObject();
-  floor.model = lveModel;
+  pendingModels.emplace_back(floor.getId(), modelRegistry.load("models/quad.obj"));
   floor.transform.translation = {0.f, .5f, 0.f};
   floor.transform.scale = {3.f, 1.f, 3.f};
   gameObjects.emplace(floor.getId(), std::move(floor));
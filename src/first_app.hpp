@@ -1,12 +1,17 @@
 #pragma once
 
+#include "lve_bindless_descriptors.hpp"
+#include "lve_defragmenter.hpp"
 #include "lve_descriptors.hpp"
 #include "lve_device.hpp"
 #include "lve_game_object.hpp"
+#include "lve_geometry_buffer.hpp"
+#include "lve_model_registry.hpp"
 #include "lve_renderer.hpp"
 #include "lve_window.hpp"
 
 // std
+#include <future>
 #include <memory>
 #include <vector>
 
@@ -15,6 +20,11 @@ class FirstApp {
  public:
   static constexpr int WIDTH = 800;
   static constexpr int HEIGHT = 600;
+  // shared by all models, 44 MiB of vertices and 16 MiB of indices
+  static constexpr uint32_t GEOMETRY_VERTEX_CAPACITY = 1 << 20;
+  static constexpr uint32_t GEOMETRY_INDEX_CAPACITY = 1 << 22;
+  // seconds between device memory reports
+  static constexpr float MEMORY_REPORT_INTERVAL = 30.f;
 
   FirstApp();
   ~FirstApp();
@@ -26,13 +36,27 @@ class FirstApp {
 
  private:
   void loadGameObjects();
+  // gives game objects their model once it has finished loading
+  void updatePendingModels();
 
   LveWindow lveWindow{WIDTH, HEIGHT, "Vulkan Tutorial"};
   LveDevice lveDevice{lveWindow};
+  LveGeometryBuffer geometryBuffer{
+      lveDevice, LveModel::VERTEX_FORMAT_FULL, GEOMETRY_VERTEX_CAPACITY, GEOMETRY_INDEX_CAPACITY};
+  LveModelRegistry modelRegistry{lveDevice, &geometryBuffer};
+  // null without descriptor indexing, outlives the renderer which releases its indices
+  std::unique_ptr<LveBindlessDescriptors> bindlessDescriptors;
+  // destroyed before the geometry buffer, as its deferred destruction frees geometry ranges
   LveRenderer lveRenderer{lveWindow, lveDevice};
+  LveDefragmenter defragmenter{lveDevice};
 
   // note: order of declarations matters
+  LveDescriptorSetLayoutCache layoutCache{lveDevice};
   std::unique_ptr<LveDescriptorPool> globalPool{};
+  // sets allocated from globalPool
+  LveDescriptorSetCache descriptorSetCache;
   LveGameObject::Map gameObjects;
+  std::vector<std::pair<LveGameObject::id_t, std::shared_future<std::shared_ptr<LveModel>>>>
+      pendingModels;
 };
 }  // namespace lve
@@ -0,0 +1,104 @@
+#include "lve_bindless_descriptors.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+LveBindlessDescriptors::LveBindlessDescriptors(LveDevice &device) : lveDevice{device} {
+  if (!lveDevice.supportsDescriptorIndexing()) {
+    throw std::runtime_error("failed to create bindless descriptors, no descriptor indexing!");
+  }
+
+  // every descriptor counts against the limits of each stage it is visible to
+  const auto &limits = lveDevice.getDescriptorIndexingProperties();
+  textures.capacity = std::min(
+      {MAX_TEXTURES,
+       limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+       limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+       limits.maxDescriptorSetUpdateAfterBindSampledImages,
+       limits.maxDescriptorSetUpdateAfterBindSamplers});
+  storageBuffers.capacity = std::min(
+      {MAX_STORAGE_BUFFERS,
+       limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+       limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+
+  // descriptors that were never written or were removed are never accessed by shaders
+  VkDescriptorBindingFlagsEXT bindingFlags =
+      VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+      VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+  setLayout = LveDescriptorSetLayout::Builder(lveDevice)
+                  .addBinding(
+                      TEXTURE_BINDING,
+                      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                      VK_SHADER_STAGE_ALL_GRAPHICS,
+                      textures.capacity,
+                      bindingFlags)
+                  .addBinding(
+                      STORAGE_BUFFER_BINDING,
+                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                      VK_SHADER_STAGE_ALL_GRAPHICS,
+                      storageBuffers.capacity,
+                      bindingFlags)
+                  .build();
+
+  pool = LveDescriptorPool::Builder(lveDevice)
+             .setMaxSets(1)
+             .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT)
+             .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textures.capacity)
+             .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBuffers.capacity)
+             .build();
+
+  if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+    throw std::runtime_error("failed to allocate bindless descriptor set!");
+  }
+}
+
+uint32_t LveBindlessDescriptors::addTexture(VkDescriptorImageInfo imageInfo) {
+  std::lock_guard<std::mutex> lock{mutex};
+  uint32_t index = acquireIndex(textures);
+  LveDescriptorWriter(*setLayout, *pool)
+      .writeImage(TEXTURE_BINDING, &imageInfo, index)
+      .overwrite(descriptorSet);
+  return index;
+}
+
+uint32_t LveBindlessDescriptors::addStorageBuffer(VkDescriptorBufferInfo bufferInfo) {
+  std::lock_guard<std::mutex> lock{mutex};
+  uint32_t index = acquireIndex(storageBuffers);
+  LveDescriptorWriter(*setLayout, *pool)
+      .writeBuffer(STORAGE_BUFFER_BINDING, &bufferInfo, index)
+      .overwrite(descriptorSet);
+  return index;
+}
+
+void LveBindlessDescriptors::removeTexture(uint32_t index) {
+  lveDevice.destroyDeferred([this, index]() { releaseIndex(textures, index); });
+}
+
+void LveBindlessDescriptors::removeStorageBuffer(uint32_t index) {
+  lveDevice.destroyDeferred([this, index]() { releaseIndex(storageBuffers, index); });
+}
+
+uint32_t LveBindlessDescriptors::acquireIndex(IndexAllocator &indices) {
+  if (!indices.freeIndices.empty()) {
+    uint32_t index = indices.freeIndices.back();
+    indices.freeIndices.pop_back();
+    return index;
+  }
+  if (indices.next >= indices.capacity) {
+    throw std::runtime_error("failed to add bindless descriptor, array is full!");
+  }
+  return indices.next++;
+}
+
+void LveBindlessDescriptors::releaseIndex(IndexAllocator &indices, uint32_t index) {
+  std::lock_guard<std::mutex> lock{mutex};
+  assert(index < indices.next && "Releasing bindless index that was never added");
+  indices.freeIndices.push_back(index);
+}
+
+}  // namespace lve
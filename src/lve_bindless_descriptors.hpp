@@ -0,0 +1,71 @@
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lve {
+
+// A single descriptor set holding large, partially bound arrays of every texture and storage
+// buffer, so shaders select resources by index (a material's texture, the buffer of per object
+// data) instead of binding a descriptor set per draw. The set is bound once per frame and can be
+// updated after binding, new resources become visible without rebuilding it.
+//
+// Requires LveDevice::supportsDescriptorIndexing(). Shaders declare the arrays as
+//   layout(set = N, binding = 0) uniform sampler2D textures[];
+//   layout(set = N, binding = 1) readonly buffer Buffer { ... } buffers[];
+class LveBindlessDescriptors {
+ public:
+  static constexpr uint32_t TEXTURE_BINDING = 0;
+  static constexpr uint32_t STORAGE_BUFFER_BINDING = 1;
+  // upper bounds, lowered to the device's update after bind limits
+  static constexpr uint32_t MAX_TEXTURES = 16384;
+  static constexpr uint32_t MAX_STORAGE_BUFFERS = 4096;
+  // index shaders treat as no resource
+  static constexpr uint32_t INVALID_INDEX = ~0u;
+
+  LveBindlessDescriptors(LveDevice &device);
+
+  LveBindlessDescriptors(const LveBindlessDescriptors &) = delete;
+  LveBindlessDescriptors &operator=(const LveBindlessDescriptors &) = delete;
+
+  // Return the array index shaders use to access the resource
+  uint32_t addTexture(VkDescriptorImageInfo imageInfo);
+  uint32_t addStorageBuffer(VkDescriptorBufferInfo bufferInfo);
+  // Indices are only reused once frames in flight can no longer access them
+  void removeTexture(uint32_t index);
+  void removeStorageBuffer(uint32_t index);
+
+  VkDescriptorSetLayout getDescriptorSetLayout() const {
+    return setLayout->getDescriptorSetLayout();
+  }
+  VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+  uint32_t getTextureCapacity() const { return textures.capacity; }
+  uint32_t getStorageBufferCapacity() const { return storageBuffers.capacity; }
+
+ private:
+  struct IndexAllocator {
+    uint32_t capacity = 0;
+    uint32_t next = 0;  // indices below next have been handed out before
+    std::vector<uint32_t> freeIndices;
+  };
+
+  uint32_t acquireIndex(IndexAllocator &indices);
+  void releaseIndex(IndexAllocator &indices, uint32_t index);
+
+  LveDevice &lveDevice;
+  std::unique_ptr<LveDescriptorSetLayout> setLayout;
+  std::unique_ptr<LveDescriptorPool> pool;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+  std::mutex mutex;
+  IndexAllocator textures;
+  IndexAllocator storageBuffers;
+};
+
+}  // namespace lve
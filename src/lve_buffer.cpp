@@ -8,6 +8,7 @@
 #include "lve_buffer.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -44,17 +45,82 @@ LveBuffer::LveBuffer(
   alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
   bufferSize = alignmentSize * instanceCount;
   device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+
+  // the memory type may have more properties than were asked for
+  hostCoherent = (device.getMemoryProperties().memoryTypes[memory.memoryTypeIndex].propertyFlags &
+                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
 }
 
 LveBuffer::~LveBuffer() {
   unmap();
-  vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
-  vkFreeMemory(lveDevice.device(), memory, nullptr);
+  setMovable(false);
+  destroyDeferred();
+}
+
+/**
+ * Frames in flight may still read the buffer, so destruction waits for their fences
+ */
+void LveBuffer::destroyDeferred() {
+  LveDevice &device = lveDevice;
+  lveDevice.destroyDeferred([&device, buffer = buffer, memory = memory]() mutable {
+    vkDestroyBuffer(device.device(), buffer, nullptr);
+    device.freeMemory(memory);
+  });
+}
+
+/**
+ * Allow LveDefragmenter to move the buffer to other memory
+ *
+ * @param movable Whether the buffer may be relocated
+ *
+ */
+void LveBuffer::setMovable(bool movable) {
+  if (movable == this->movable) {
+    return;
+  }
+  assert(
+      (!movable || (usageFlags & VK_BUFFER_USAGE_TRANSFER_SRC_BIT &&
+                    usageFlags & VK_BUFFER_USAGE_TRANSFER_DST_BIT)) &&
+      "Movable buffers need transfer src and dst usage");
+  this->movable = movable;
+  if (movable) {
+    lveDevice.registerMovableBuffer(this);
+  } else {
+    lveDevice.unregisterMovableBuffer(this);
+  }
+}
+
+/**
+ * Moves the buffer to new memory, picked by the allocator now
+ *
+ * @note The copy is ordered like any other transfer in commandBuffer, users of the buffer later in
+ * the command buffer need a barrier
+ *
+ * @param commandBuffer Command buffer recording the copy, submitted to the graphics queue
+ *
+ */
+void LveBuffer::relocate(VkCommandBuffer commandBuffer) {
+  assert(movable && mapped == nullptr && "Only movable, unmapped buffers can be relocated");
+
+  VkBuffer newBuffer;
+  LveMemoryAllocator::Allocation newMemory{};
+  lveDevice.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, newBuffer, newMemory);
+
+  VkBufferCopy copyRegion{};
+  copyRegion.size = bufferSize;
+  vkCmdCopyBuffer(commandBuffer, buffer, newBuffer, 1, &copyRegion);
+
+  destroyDeferred();
+  buffer = newBuffer;
+  memory = newMemory;
 }
 
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
  *
+ * @note Host visible memory stays mapped by the allocator, this only points into that mapping, so
+ * size is only checked against the buffer and nothing outside the range is protected
+ *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
  * buffer range.
  * @param offset (Optional) Byte offset from beginning
@@ -62,21 +128,24 @@ LveBuffer::~LveBuffer() {
  * @return VkResult of the buffer mapping call
  */
 VkResult LveBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-  assert(buffer && memory && "Called map on buffer before create");
-  return vkMapMemory(lveDevice.device(), memory, offset, size, 0, &mapped);
+  assert(buffer && memory.memory && "Called map on buffer before create");
+  assert(offset <= bufferSize && "Cannot map past the end of the buffer");
+  assert(
+      (size == VK_WHOLE_SIZE || size <= bufferSize - offset) &&
+      "Cannot map past the end of the buffer");
+  if (memory.mapped == nullptr) {
+    return VK_ERROR_MEMORY_MAP_FAILED;
+  }
+  mapped = static_cast<char *>(memory.mapped) + offset;
+  return VK_SUCCESS;
 }
 
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note Does not return a result as unmapping can't fail
  */
-void LveBuffer::unmap() {
-  if (mapped) {
-    vkUnmapMemory(lveDevice.device(), memory);
-    mapped = nullptr;
-  }
-}
+void LveBuffer::unmap() { mapped = nullptr; }
 
 /**
  * Copies the specified data to the mapped buffer. Default value writes whole buffer range
@@ -97,26 +166,84 @@ void LveBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset
     memOffset += offset;
     memcpy(memOffset, data, size);
   }
+  markDirty(size, offset);
 }
 
 /**
- * Flush a memory range of the buffer to make it visible to the device
+ * Records a written range of the buffer, to be made visible to the device by the next flush
  *
- * @note Only required for non-coherent memory
+ * @note Ranges are not tracked for coherent memory
  *
- * @param size (Optional) Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush the
- * complete buffer range.
+ * @param size (Optional) Size of the written range. Pass VK_WHOLE_SIZE for the complete buffer
+ * range.
+ * @param offset (Optional) Byte offset from beginning
+ *
+ */
+void LveBuffer::markDirty(VkDeviceSize size, VkDeviceSize offset) {
+  if (hostCoherent) {
+    return;
+  }
+
+  VkDeviceSize end = size == VK_WHOLE_SIZE ? bufferSize : offset + size;
+  // consecutive writes extend the last range instead of adding one
+  if (!dirtyRanges.empty() && dirtyRanges.back().begin <= offset &&
+      offset <= dirtyRanges.back().end) {
+    dirtyRanges.back().end = std::max(dirtyRanges.back().end, end);
+    return;
+  }
+  dirtyRanges.push_back({offset, end});
+}
+
+/**
+ * Flush the ranges written since the last flush to make them visible to the device
+ *
+ * @note Only required for non-coherent memory, does nothing for coherent memory
+ *
+ * @return VkResult of the flush call
+ */
+VkResult LveBuffer::flush() {
+  if (dirtyRanges.empty()) {
+    return VK_SUCCESS;
+  }
+
+  // ranges are widened to nonCoherentAtomSize, so neighbours may overlap once aligned
+  std::vector<VkMappedMemoryRange> &ranges = flushRanges;
+  ranges.clear();
+  std::sort(dirtyRanges.begin(), dirtyRanges.end(), [](const auto &a, const auto &b) {
+    return a.begin < b.begin;
+  });
+  for (auto &dirty : dirtyRanges) {
+    VkMappedMemoryRange range = mappedMemoryRange(dirty.end - dirty.begin, dirty.begin);
+    if (!ranges.empty() && range.offset <= ranges.back().offset + ranges.back().size) {
+      VkMappedMemoryRange &last = ranges.back();
+      last.size = std::max(last.offset + last.size, range.offset + range.size) - last.offset;
+      continue;
+    }
+    ranges.push_back(range);
+  }
+  dirtyRanges.clear();
+
+  return vkFlushMappedMemoryRanges(
+      lveDevice.device(),
+      static_cast<uint32_t>(ranges.size()),
+      ranges.data());
+}
+
+/**
+ * Flush a memory range of the buffer to make it visible to the device, along with the ranges
+ * written since the last flush
+ *
+ * @note Only required for non-coherent memory, does nothing for coherent memory
+ *
+ * @param size Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush the complete buffer
+ * range.
  * @param offset (Optional) Byte offset from beginning
  *
  * @return VkResult of the flush call
  */
 VkResult LveBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
-  return vkFlushMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+  markDirty(size, offset);
+  return flush();
 }
 
 /**
@@ -131,12 +258,40 @@ VkResult LveBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
  * @return VkResult of the invalidate call
  */
 VkResult LveBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
+  if (hostCoherent) {
+    return VK_SUCCESS;
+  }
+  VkMappedMemoryRange mappedRange = mappedMemoryRange(size, offset);
+  return vkInvalidateMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+}
+
+/**
+ * Translates a range of the buffer to a range of the device memory it was sub-allocated from,
+ * widened to multiples of nonCoherentAtomSize
+ *
+ * @note Host visible allocations are aligned and padded to nonCoherentAtomSize, so the widened
+ * range never reaches into another allocation
+ *
+ * @param size Size of the range. VK_WHOLE_SIZE stops at the end of this buffer's allocation
+ * rather than at the end of the shared memory block.
+ * @param offset Byte offset from beginning
+ *
+ * @return VkMappedMemoryRange covering the range
+ */
+VkMappedMemoryRange LveBuffer::mappedMemoryRange(VkDeviceSize size, VkDeviceSize offset) {
+  VkDeviceSize atomSize = lveDevice.properties.limits.nonCoherentAtomSize;
+  VkDeviceSize begin = offset / atomSize * atomSize;
+  VkDeviceSize end = memory.size;
+  if (size != VK_WHOLE_SIZE) {
+    end = std::min((offset + size + atomSize - 1) / atomSize * atomSize, memory.size);
+  }
+
   VkMappedMemoryRange mappedRange = {};
   mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
-  return vkInvalidateMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+  mappedRange.memory = memory.memory;
+  mappedRange.offset = memory.offset + begin;
+  mappedRange.size = end - begin;
+  return mappedRange;
 }
 
 /**
@@ -2,6 +2,9 @@
 
 #include "lve_device.hpp"
 
+// std
+#include <vector>
+
 namespace lve {
 
 class LveBuffer {
@@ -22,7 +25,11 @@ class LveBuffer {
   void unmap();
 
   void writeToBuffer(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
-  VkResult flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+  // Records a range written through getMappedMemory() for the next flush
+  void markDirty(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+  // Flushes every range written since the last flush in a single call
+  VkResult flush();
+  VkResult flush(VkDeviceSize size, VkDeviceSize offset = 0);
   VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
   VkResult invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
@@ -31,22 +38,41 @@ class LveBuffer {
   VkDescriptorBufferInfo descriptorInfoForIndex(int index);
   VkResult invalidateIndex(int index);
 
+  // Movable buffers may be relocated by LveDefragmenter, so their VkBuffer must be looked up again
+  // every frame rather than kept, such as in descriptor sets. Requires transfer src and dst usage.
+  void setMovable(bool movable);
+  bool isMovable() const { return movable; }
+  // Moves the contents to a newly allocated buffer, recording the copy into commandBuffer. The old
+  // buffer is destroyed once frames in flight are done with it.
+  void relocate(VkCommandBuffer commandBuffer);
+
   VkBuffer getBuffer() const { return buffer; }
   void* getMappedMemory() const { return mapped; }
   uint32_t getInstanceCount() const { return instanceCount; }
   VkDeviceSize getInstanceSize() const { return instanceSize; }
   VkDeviceSize getAlignmentSize() const { return instanceSize; }
   VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
+  const LveMemoryAllocator::Allocation &getMemory() const { return memory; }
   VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
   VkDeviceSize getBufferSize() const { return bufferSize; }
+  // Coherent memory never needs to be flushed or invalidated
+  bool isHostCoherent() const { return hostCoherent; }
 
  private:
   static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
+  VkMappedMemoryRange mappedMemoryRange(VkDeviceSize size, VkDeviceSize offset);
+  // destroys buffer and frees memory once frames in flight are done with them
+  void destroyDeferred();
+
+  struct DirtyRange {
+    VkDeviceSize begin;
+    VkDeviceSize end;
+  };
 
   LveDevice& lveDevice;
   void* mapped = nullptr;
   VkBuffer buffer = VK_NULL_HANDLE;
-  VkDeviceMemory memory = VK_NULL_HANDLE;
+  LveMemoryAllocator::Allocation memory{};
 
   VkDeviceSize bufferSize;
   uint32_t instanceCount;
@@ -54,6 +80,10 @@ class LveBuffer {
   VkDeviceSize alignmentSize;
   VkBufferUsageFlags usageFlags;
   VkMemoryPropertyFlags memoryPropertyFlags;
+  bool hostCoherent = false;
+  bool movable = false;
+  std::vector<DirtyRange> dirtyRanges;
+  std::vector<VkMappedMemoryRange> flushRanges;  // reused so flushing does not allocate
 };
 
 }  // namespace lve
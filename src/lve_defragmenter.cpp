@@ -0,0 +1,101 @@
+#include "lve_defragmenter.hpp"
+
+#include "lve_buffer.hpp"
+
+// std
+#include <unordered_map>
+
+namespace lve {
+
+LveDefragmenter::LveDefragmenter(LveDevice &device, VkDeviceSize bytesPerFrame)
+    : lveDevice{device}, bytesPerFrame{bytesPerFrame} {}
+
+void LveDefragmenter::update(VkCommandBuffer commandBuffer) {
+  LveMemoryAllocator &allocator = lveDevice.memoryAllocator();
+  if (evacuatingBlock != nullptr && !allocator.isEvacuating()) {
+    // everything moved out was destroyed and the block released
+    evacuatingBlock = nullptr;
+  }
+
+  if (evacuatingBlock == nullptr) {
+    if (--framesUntilSearch > 0) {
+      return;
+    }
+    framesUntilSearch = SEARCH_INTERVAL;
+    evacuatingBlock = findEvacuationCandidate();
+    if (evacuatingBlock == nullptr) {
+      return;
+    }
+    allocator.setEvacuatingBlock(evacuatingBlock);
+    idleFrames = 0;
+  }
+
+  // at least one buffer moves each frame, however large
+  VkDeviceSize movedBytes = 0;
+  for (LveBuffer *buffer : lveDevice.getMovableBuffers()) {
+    if (movedBytes >= bytesPerFrame) break;
+    if (buffer->getMemory().block != evacuatingBlock) continue;
+    buffer->relocate(commandBuffer);
+    movedBytes += buffer->getBufferSize();
+  }
+
+  if (movedBytes == 0) {
+    // the old buffers are released once frames in flight finish, unless something else holds on
+    if (++idleFrames >= SEARCH_INTERVAL) {
+      cancelEvacuation();
+    }
+    return;
+  }
+
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                          VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                          VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+}
+
+const LveMemoryAllocator::Block *LveDefragmenter::findEvacuationCandidate() {
+  std::unordered_map<const LveMemoryAllocator::Block *, uint32_t> movableCounts;
+  for (LveBuffer *buffer : lveDevice.getMovableBuffers()) {
+    if (buffer->getMemory().block != nullptr) {
+      movableCounts[buffer->getMemory().block]++;
+    }
+  }
+
+  LveMemoryAllocator &allocator = lveDevice.memoryAllocator();
+  const LveMemoryAllocator::Block *candidate = nullptr;
+  VkDeviceSize candidateUsedBytes = 0;
+  for (auto &kv : movableCounts) {
+    LveMemoryAllocator::BlockUsage usage{};
+    if (!allocator.getBlockUsage(kv.first, usage)) continue;
+    if (usage.allocationCount != kv.second) continue;
+    if (usage.usedBytes > usage.size * MAX_EVACUATION_USAGE) continue;
+    // leave slack, as the free space of the other blocks may itself be fragmented
+    if (usage.otherFreeBytes < usage.usedBytes * 2) continue;
+
+    if (candidate == nullptr || usage.usedBytes < candidateUsedBytes) {
+      candidate = kv.first;
+      candidateUsedBytes = usage.usedBytes;
+    }
+  }
+  return candidate;
+}
+
+void LveDefragmenter::cancelEvacuation() {
+  lveDevice.memoryAllocator().setEvacuatingBlock(nullptr);
+  evacuatingBlock = nullptr;
+}
+
+}  // namespace lve
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+namespace lve {
+
+// Compacts device memory over many frames by moving movable LveBuffers out of sparsely used
+// memory blocks, which the allocator releases once they are empty. Copies are recorded into the
+// frame's command buffer and limited to bytesPerFrame, so compaction never causes a hitch. Old
+// buffers are destroyed through LveDevice::destroyDeferred once frames in flight are done.
+class LveDefragmenter {
+ public:
+  static constexpr VkDeviceSize DEFAULT_BYTES_PER_FRAME = 4ull << 20;
+  // blocks used below this fraction are evacuated
+  static constexpr float MAX_EVACUATION_USAGE = .5f;
+  // frames between searches for a block to evacuate, and before giving up on one
+  static constexpr uint32_t SEARCH_INTERVAL = 120;
+
+  LveDefragmenter(LveDevice &device, VkDeviceSize bytesPerFrame = DEFAULT_BYTES_PER_FRAME);
+
+  LveDefragmenter(const LveDefragmenter &) = delete;
+  LveDefragmenter &operator=(const LveDefragmenter &) = delete;
+
+  // Call once per frame outside of a render pass, before anything uses the moved buffers
+  void update(VkCommandBuffer commandBuffer);
+  bool isEvacuating() const { return evacuatingBlock != nullptr; }
+
+ private:
+  // sparsest block holding only movable buffers, if its contents fit into the other blocks
+  const LveMemoryAllocator::Block *findEvacuationCandidate();
+  void cancelEvacuation();
+
+  LveDevice &lveDevice;
+  VkDeviceSize bytesPerFrame;
+  uint32_t framesUntilSearch = SEARCH_INTERVAL;
+  uint32_t idleFrames = 0;
+  const LveMemoryAllocator::Block *evacuatingBlock = nullptr;
+};
+
+}  // namespace lve
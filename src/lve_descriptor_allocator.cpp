@@ -0,0 +1,109 @@
+#include "lve_descriptor_allocator.hpp"
+
+// std
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+// descriptors of each type per set in a pool, enough for a few of the common kinds per set
+struct PoolRatio {
+  VkDescriptorType type;
+  float perSet;
+};
+constexpr std::array<PoolRatio, 7> POOL_RATIOS{{
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+}};
+}  // namespace
+
+LveDescriptorAllocator::LveDescriptorAllocator(
+    LveDevice &device, uint32_t setsPerPool, int frameCount)
+    : lveDevice{device}, setsPerPool{setsPerPool}, frames(frameCount) {}
+
+LveDescriptorAllocator::~LveDescriptorAllocator() {
+  for (auto &frame : frames) {
+    for (auto pool : frame.usedPools) {
+      vkDestroyDescriptorPool(lveDevice.device(), pool, nullptr);
+    }
+  }
+  for (auto pool : freePools) {
+    vkDestroyDescriptorPool(lveDevice.device(), pool, nullptr);
+  }
+}
+
+void LveDescriptorAllocator::beginFrame(int frameIndex) {
+  assert(frameIndex >= 0 && frameIndex < frames.size() && "Frame index out of range");
+  currentFrame = frameIndex;
+
+  for (auto pool : frames[frameIndex].usedPools) {
+    vkResetDescriptorPool(lveDevice.device(), pool, 0);
+    freePools.push_back(pool);
+  }
+  frames[frameIndex].usedPools.clear();
+}
+
+VkDescriptorSet LveDescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+  assert(currentFrame >= 0 && "Cannot allocate descriptor sets before beginFrame");
+  auto &usedPools = frames[currentFrame].usedPools;
+  if (usedPools.empty()) {
+    usedPools.push_back(acquirePool());
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = usedPools.back();
+  allocInfo.pSetLayouts = &layout;
+  allocInfo.descriptorSetCount = 1;
+
+  VkDescriptorSet set;
+  VkResult result = vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &set);
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+    // the current pool is full, continue in a fresh one
+    usedPools.push_back(acquirePool());
+    allocInfo.descriptorPool = usedPools.back();
+    result = vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &set);
+  }
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate descriptor set!");
+  }
+  return set;
+}
+
+VkDescriptorPool LveDescriptorAllocator::acquirePool() {
+  if (freePools.empty()) {
+    return createPool();
+  }
+  VkDescriptorPool pool = freePools.back();
+  freePools.pop_back();
+  return pool;
+}
+
+VkDescriptorPool LveDescriptorAllocator::createPool() {
+  std::vector<VkDescriptorPoolSize> poolSizes{};
+  for (auto &ratio : POOL_RATIOS) {
+    poolSizes.push_back({ratio.type, static_cast<uint32_t>(ratio.perSet * setsPerPool)});
+  }
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = setsPerPool;
+
+  VkDescriptorPool pool;
+  if (vkCreateDescriptorPool(lveDevice.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor pool!");
+  }
+  poolCount++;
+  return pool;
+}
+
+}  // namespace lve
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Allocates transient descriptor sets that live for one frame. Every frame in flight owns a chain
+// of descriptor pools that grows by another pool whenever the current one runs out, and that is
+// reset as a whole with vkResetDescriptorPool once the frame's fence has signaled. Reset pools go
+// back to a shared free list, so in steady state allocating a set never creates a pool and never
+// fails.
+class LveDescriptorAllocator {
+ public:
+  static constexpr uint32_t DEFAULT_SETS_PER_POOL = 256;
+
+  LveDescriptorAllocator(
+      LveDevice &device,
+      uint32_t setsPerPool = DEFAULT_SETS_PER_POOL,
+      int frameCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  ~LveDescriptorAllocator();
+
+  LveDescriptorAllocator(const LveDescriptorAllocator &) = delete;
+  LveDescriptorAllocator &operator=(const LveDescriptorAllocator &) = delete;
+
+  // Resets the pools of frameIndex, invalidating the sets allocated the last time it was begun.
+  // Only call once the frame's previous submission has finished, which LveRenderer::beginFrame
+  // ensures.
+  void beginFrame(int frameIndex);
+
+  // The set is valid until its frame is begun again
+  VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+  uint32_t getPoolCount() const { return poolCount; }
+
+ private:
+  struct Frame {
+    std::vector<VkDescriptorPool> usedPools;  // the last one is allocated from
+  };
+
+  VkDescriptorPool acquirePool();
+  VkDescriptorPool createPool();
+
+  LveDevice &lveDevice;
+  uint32_t setsPerPool;
+  std::vector<Frame> frames;
+  std::vector<VkDescriptorPool> freePools;  // reset and ready for reuse
+  int currentFrame = -1;
+  uint32_t poolCount = 0;
+};
+
+}  // namespace lve
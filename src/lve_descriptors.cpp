@@ -1,18 +1,30 @@
 #include "lve_descriptors.hpp"
 
+#include "lve_utils.hpp"
+
 // std
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
 namespace lve {
 
+namespace {
+bool isImageDescriptor(VkDescriptorType type) {
+  return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+         type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+         type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+}  // namespace
+
 // *************** Descriptor Set Layout Builder *********************
 
 LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::addBinding(
     uint32_t binding,
     VkDescriptorType descriptorType,
     VkShaderStageFlags stageFlags,
-    uint32_t count) {
+    uint32_t count,
+    VkDescriptorBindingFlagsEXT flags) {
   assert(bindings.count(binding) == 0 && "Binding already in use");
   VkDescriptorSetLayoutBinding layoutBinding{};
   layoutBinding.binding = binding;
@@ -20,21 +32,50 @@ LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::addBinding(
   layoutBinding.descriptorCount = count;
   layoutBinding.stageFlags = stageFlags;
   bindings[binding] = layoutBinding;
+  if (flags != 0) {
+    assert(lveDevice.supportsDescriptorIndexing() && "Binding flags need descriptor indexing");
+    bindingFlags[binding] = flags;
+  }
   return *this;
 }
 
 std::unique_ptr<LveDescriptorSetLayout> LveDescriptorSetLayout::Builder::build() const {
-  return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings);
+  return std::make_unique<LveDescriptorSetLayout>(
+      lveDevice,
+      bindings,
+      bindingFlags,
+      pushDescriptor);
+}
+
+std::shared_ptr<LveDescriptorSetLayout> LveDescriptorSetLayout::Builder::build(
+    LveDescriptorSetLayoutCache &cache) const {
+  return cache.getLayout(bindings, bindingFlags, pushDescriptor);
+}
+
+LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::setPushDescriptor() {
+  assert(lveDevice.supportsPushDescriptors() && "Push descriptors are not supported");
+  pushDescriptor = true;
+  return *this;
 }
 
 // *************** Descriptor Set Layout *********************
 
 LveDescriptorSetLayout::LveDescriptorSetLayout(
-    LveDevice &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
-    : lveDevice{lveDevice}, bindings{bindings} {
+    LveDevice &lveDevice,
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+    std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> bindingFlags,
+    bool pushDescriptor)
+    : lveDevice{lveDevice}, bindings{bindings}, pushDescriptor{pushDescriptor} {
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+  std::vector<VkDescriptorBindingFlagsEXT> setLayoutBindingFlags{};
   for (auto kv : bindings) {
     setLayoutBindings.push_back(kv.second);
+    auto flags = bindingFlags.find(kv.first);
+    setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+    if (flags != bindingFlags.end() &&
+        (flags->second & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT)) {
+      updateAfterBind = true;
+    }
   }
 
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
@@ -42,6 +83,20 @@ LveDescriptorSetLayout::LveDescriptorSetLayout(
   descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
   descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+  VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+  if (!bindingFlags.empty()) {
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+    descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+  }
+  if (updateAfterBind) {
+    descriptorSetLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+  }
+  if (pushDescriptor) {
+    descriptorSetLayoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+  }
+
   if (vkCreateDescriptorSetLayout(
           lveDevice.device(),
           &descriptorSetLayoutInfo,
@@ -49,12 +104,184 @@ LveDescriptorSetLayout::LveDescriptorSetLayout(
           &descriptorSetLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create descriptor set layout!");
   }
+
+  // packed template data follows binding order
+  std::sort(setLayoutBindings.begin(), setLayoutBindings.end(), [](const auto &a, const auto &b) {
+    return a.binding < b.binding;
+  });
+  for (auto &binding : setLayoutBindings) {
+    VkDescriptorUpdateTemplateEntryKHR entry{};
+    entry.dstBinding = binding.binding;
+    entry.dstArrayElement = 0;
+    entry.descriptorCount = binding.descriptorCount;
+    entry.descriptorType = binding.descriptorType;
+    entry.offset = templateDescriptorCount * sizeof(TemplateDescriptor);
+    entry.stride = sizeof(TemplateDescriptor);
+    templateEntries.push_back(entry);
+    templateDescriptorCount += binding.descriptorCount;
+  }
 }
 
 LveDescriptorSetLayout::~LveDescriptorSetLayout() {
+  if (updateTemplate != VK_NULL_HANDLE) {
+    lveDevice.descriptorFunctions().destroyUpdateTemplate(
+        lveDevice.device(),
+        updateTemplate,
+        nullptr);
+  }
   vkDestroyDescriptorSetLayout(lveDevice.device(), descriptorSetLayout, nullptr);
 }
 
+uint32_t LveDescriptorSetLayout::getTemplateOffset(uint32_t binding) const {
+  for (auto &entry : templateEntries) {
+    if (entry.dstBinding == binding) {
+      return static_cast<uint32_t>(entry.offset / sizeof(TemplateDescriptor));
+    }
+  }
+  assert(false && "Layout does not contain specified binding");
+  return 0;
+}
+
+void LveDescriptorSetLayout::update(VkDescriptorSet set, const TemplateDescriptor *descriptors) {
+  assert(!pushDescriptor && "Push descriptor layouts have no sets to update");
+  if (!lveDevice.supportsDescriptorUpdateTemplates()) {
+    prepareTemplateWrites(descriptors);
+    for (auto &write : templateWrites) {
+      write.dstSet = set;
+    }
+    vkUpdateDescriptorSets(
+        lveDevice.device(),
+        static_cast<uint32_t>(templateWrites.size()),
+        templateWrites.data(),
+        0,
+        nullptr);
+    return;
+  }
+
+  if (updateTemplate == VK_NULL_HANDLE) {
+    VkDescriptorUpdateTemplateCreateInfoKHR templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+    templateInfo.pDescriptorUpdateEntries = templateEntries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = descriptorSetLayout;
+    if (lveDevice.descriptorFunctions().createUpdateTemplate(
+            lveDevice.device(),
+            &templateInfo,
+            nullptr,
+            &updateTemplate) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create descriptor update template!");
+    }
+  }
+  lveDevice.descriptorFunctions().updateWithTemplate(
+      lveDevice.device(),
+      set,
+      updateTemplate,
+      descriptors);
+}
+
+void LveDescriptorSetLayout::push(
+    VkCommandBuffer commandBuffer,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout pipelineLayout,
+    uint32_t setIndex,
+    const TemplateDescriptor *descriptors) {
+  assert(pushDescriptor && "Layout was not built with setPushDescriptor");
+  prepareTemplateWrites(descriptors);
+  lveDevice.descriptorFunctions().pushDescriptorSet(
+      commandBuffer,
+      bindPoint,
+      pipelineLayout,
+      setIndex,
+      static_cast<uint32_t>(templateWrites.size()),
+      templateWrites.data());
+}
+
+void LveDescriptorSetLayout::prepareTemplateWrites(const TemplateDescriptor *descriptors) {
+  // the union lets buffer and image infos be read as arrays with the template stride
+  static_assert(
+      sizeof(TemplateDescriptor) == sizeof(VkDescriptorBufferInfo) &&
+          sizeof(TemplateDescriptor) == sizeof(VkDescriptorImageInfo),
+      "Template descriptors must be as large as buffer and image infos");
+
+  templateWrites.resize(templateEntries.size());
+  for (size_t i = 0; i < templateEntries.size(); i++) {
+    const auto &entry = templateEntries[i];
+    const TemplateDescriptor *first = descriptors + entry.offset / sizeof(TemplateDescriptor);
+
+    VkWriteDescriptorSet &write = templateWrites[i];
+    write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstBinding = entry.dstBinding;
+    write.descriptorCount = entry.descriptorCount;
+    write.descriptorType = entry.descriptorType;
+    if (isImageDescriptor(entry.descriptorType)) {
+      write.pImageInfo = &first->image;
+    } else {
+      write.pBufferInfo = &first->buffer;
+    }
+  }
+}
+
+// *************** Descriptor Set Layout Cache *********************
+
+std::shared_ptr<LveDescriptorSetLayout> LveDescriptorSetLayoutCache::getLayout(
+    const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+    const std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> &bindingFlags,
+    bool pushDescriptor) {
+  std::vector<VkDescriptorSetLayoutBinding> sorted{};
+  for (auto &kv : bindings) {
+    sorted.push_back(kv.second);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+    return a.binding < b.binding;
+  });
+  std::vector<VkDescriptorBindingFlagsEXT> sortedFlags{};
+  for (auto &binding : sorted) {
+    auto flags = bindingFlags.find(binding.binding);
+    sortedFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+  }
+
+  size_t seed = 0;
+  hashCombine(seed, pushDescriptor);
+  for (size_t i = 0; i < sorted.size(); i++) {
+    hashCombine(
+        seed,
+        sorted[i].binding,
+        static_cast<uint32_t>(sorted[i].descriptorType),
+        sorted[i].descriptorCount,
+        sorted[i].stageFlags,
+        sortedFlags[i]);
+  }
+
+  auto sameBindings = [&](const Entry &entry) {
+    return entry.pushDescriptor == pushDescriptor && entry.bindingFlags == sortedFlags &&
+           std::equal(
+               sorted.begin(),
+               sorted.end(),
+               entry.bindings.begin(),
+               entry.bindings.end(),
+               [](const auto &a, const auto &b) {
+                 return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+                        a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags &&
+                        a.pImmutableSamplers == b.pImmutableSamplers;
+               });
+  };
+
+  auto &entries = layouts[seed];
+  for (auto &entry : entries) {
+    if (sameBindings(entry)) {
+      return entry.layout;
+    }
+  }
+
+  auto layout =
+      std::make_shared<LveDescriptorSetLayout>(lveDevice, bindings, bindingFlags, pushDescriptor);
+  entries.push_back({std::move(sorted), std::move(sortedFlags), pushDescriptor, layout});
+  layoutCount++;
+  return layout;
+}
+
 // *************** Descriptor Pool Builder *********************
 
 LveDescriptorPool::Builder &LveDescriptorPool::Builder::addPoolSize(
@@ -133,22 +360,27 @@ void LveDescriptorPool::resetPool() {
 // *************** Descriptor Writer *********************
 
 LveDescriptorWriter::LveDescriptorWriter(LveDescriptorSetLayout &setLayout, LveDescriptorPool &pool)
-    : setLayout{setLayout}, pool{pool} {}
+    : setLayout{setLayout}, pool{&pool} {}
+
+LveDescriptorWriter::LveDescriptorWriter(
+    LveDescriptorSetLayout &setLayout, LveDescriptorAllocator &allocator)
+    : setLayout{setLayout}, allocator{&allocator} {}
 
 LveDescriptorWriter &LveDescriptorWriter::writeBuffer(
-    uint32_t binding, VkDescriptorBufferInfo *bufferInfo) {
+    uint32_t binding, VkDescriptorBufferInfo *bufferInfo, uint32_t arrayElement) {
   assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
 
   auto &bindingDescription = setLayout.bindings[binding];
 
   assert(
-      bindingDescription.descriptorCount == 1 &&
-      "Binding single descriptor info, but binding expects multiple");
+      arrayElement < bindingDescription.descriptorCount &&
+      "Array element out of range of the binding");
 
   VkWriteDescriptorSet write{};
   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
   write.descriptorType = bindingDescription.descriptorType;
   write.dstBinding = binding;
+  write.dstArrayElement = arrayElement;
   write.pBufferInfo = bufferInfo;
   write.descriptorCount = 1;
 
@@ -157,19 +389,20 @@ LveDescriptorWriter &LveDescriptorWriter::writeBuffer(
 }
 
 LveDescriptorWriter &LveDescriptorWriter::writeImage(
-    uint32_t binding, VkDescriptorImageInfo *imageInfo) {
+    uint32_t binding, VkDescriptorImageInfo *imageInfo, uint32_t arrayElement) {
   assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
 
   auto &bindingDescription = setLayout.bindings[binding];
 
   assert(
-      bindingDescription.descriptorCount == 1 &&
-      "Binding single descriptor info, but binding expects multiple");
+      arrayElement < bindingDescription.descriptorCount &&
+      "Array element out of range of the binding");
 
   VkWriteDescriptorSet write{};
   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
   write.descriptorType = bindingDescription.descriptorType;
   write.dstBinding = binding;
+  write.dstArrayElement = arrayElement;
   write.pImageInfo = imageInfo;
   write.descriptorCount = 1;
 
@@ -178,7 +411,13 @@ LveDescriptorWriter &LveDescriptorWriter::writeImage(
 }
 
 bool LveDescriptorWriter::build(VkDescriptorSet &set) {
-  bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
+  if (allocator != nullptr) {
+    set = allocator->allocate(setLayout.getDescriptorSetLayout());
+    overwrite(set);
+    return true;
+  }
+
+  bool success = pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
   if (!success) {
     return false;
   }
@@ -186,11 +425,87 @@ bool LveDescriptorWriter::build(VkDescriptorSet &set) {
   return true;
 }
 
+bool LveDescriptorWriter::build(VkDescriptorSet &set, LveDescriptorSetCache &cache) {
+  assert(allocator == nullptr && "Cannot cache descriptor sets that only live for one frame");
+  LveDescriptorSetCache::Key key{};
+  key.layout = setLayout.getDescriptorSetLayout();
+  for (auto &write : writes) {
+    LveDescriptorSetCache::Descriptor descriptor{};
+    descriptor.binding = write.dstBinding;
+    descriptor.arrayElement = write.dstArrayElement;
+    descriptor.type = write.descriptorType;
+    if (write.pBufferInfo != nullptr) {
+      descriptor.buffer = write.pBufferInfo->buffer;
+      descriptor.offset = write.pBufferInfo->offset;
+      descriptor.range = write.pBufferInfo->range;
+    }
+    if (write.pImageInfo != nullptr) {
+      descriptor.sampler = write.pImageInfo->sampler;
+      descriptor.imageView = write.pImageInfo->imageView;
+      descriptor.imageLayout = write.pImageInfo->imageLayout;
+    }
+    key.descriptors.push_back(descriptor);
+  }
+  std::sort(key.descriptors.begin(), key.descriptors.end(), [](const auto &a, const auto &b) {
+    return a.binding < b.binding || (a.binding == b.binding && a.arrayElement < b.arrayElement);
+  });
+
+  if (cache.find(key, set)) {
+    return true;
+  }
+  if (!build(set)) {
+    return false;
+  }
+  cache.insert(std::move(key), set);
+  return true;
+}
+
 void LveDescriptorWriter::overwrite(VkDescriptorSet &set) {
   for (auto &write : writes) {
     write.dstSet = set;
   }
-  vkUpdateDescriptorSets(pool.lveDevice.device(), writes.size(), writes.data(), 0, nullptr);
+  vkUpdateDescriptorSets(setLayout.lveDevice.device(), writes.size(), writes.data(), 0, nullptr);
+}
+
+// *************** Descriptor Set Cache *********************
+
+bool LveDescriptorSetCache::Descriptor::operator==(const Descriptor &other) const {
+  return binding == other.binding && arrayElement == other.arrayElement && type == other.type &&
+         buffer == other.buffer && offset == other.offset && range == other.range &&
+         sampler == other.sampler && imageView == other.imageView &&
+         imageLayout == other.imageLayout;
+}
+
+size_t LveDescriptorSetCache::KeyHash::operator()(const Key &key) const {
+  size_t seed = 0;
+  hashCombine(seed, key.layout);
+  for (auto &descriptor : key.descriptors) {
+    hashCombine(
+        seed,
+        descriptor.binding,
+        descriptor.arrayElement,
+        static_cast<uint32_t>(descriptor.type),
+        descriptor.buffer,
+        descriptor.offset,
+        descriptor.range,
+        descriptor.sampler,
+        descriptor.imageView,
+        static_cast<uint32_t>(descriptor.imageLayout));
+  }
+  return seed;
+}
+
+bool LveDescriptorSetCache::find(const Key &key, VkDescriptorSet &set) const {
+  auto it = sets.find(key);
+  if (it == sets.end()) {
+    return false;
+  }
+  set = it->second;
+  return true;
+}
+
+void LveDescriptorSetCache::insert(Key key, VkDescriptorSet set) {
+  sets.emplace(std::move(key), set);
 }
 
 }  // namespace lve
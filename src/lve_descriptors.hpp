@@ -1,5 +1,6 @@
 #pragma once
 
+#include "lve_descriptor_allocator.hpp"
 #include "lve_device.hpp"
 
 // std
@@ -9,40 +10,119 @@
 
 namespace lve {
 
+class LveDescriptorSetLayoutCache;
+class LveDescriptorSetCache;
+
 class LveDescriptorSetLayout {
  public:
   class Builder {
    public:
     Builder(LveDevice &lveDevice) : lveDevice{lveDevice} {}
 
+    // flags such as VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT need descriptor indexing
     Builder &addBinding(
         uint32_t binding,
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
-        uint32_t count = 1);
+        uint32_t count = 1,
+        VkDescriptorBindingFlagsEXT flags = 0);
     std::unique_ptr<LveDescriptorSetLayout> build() const;
+    // returns the cached layout with the same bindings, creating it on first use
+    std::shared_ptr<LveDescriptorSetLayout> build(LveDescriptorSetLayoutCache &cache) const;
+    // descriptors are pushed into command buffers with push() instead of allocated in sets, needs
+    // LveDevice::supportsPushDescriptors()
+    Builder &setPushDescriptor();
 
    private:
     LveDevice &lveDevice;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> bindingFlags{};
+    bool pushDescriptor = false;
+  };
+
+  // One descriptor of the packed data passed to update() and push(). Bindings follow each other
+  // in binding order, with every element of an array binding in turn, see getTemplateOffset().
+  union TemplateDescriptor {
+    VkDescriptorBufferInfo buffer;
+    VkDescriptorImageInfo image;
   };
 
   LveDescriptorSetLayout(
-      LveDevice &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+      LveDevice &lveDevice,
+      std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+      std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> bindingFlags = {},
+      bool pushDescriptor = false);
   ~LveDescriptorSetLayout();
   LveDescriptorSetLayout(const LveDescriptorSetLayout &) = delete;
   LveDescriptorSetLayout &operator=(const LveDescriptorSetLayout &) = delete;
 
   VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+  // sets of layouts with update after bind bindings must come from a pool created with
+  // VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT
+  bool isUpdateAfterBind() const { return updateAfterBind; }
+  bool isPushDescriptor() const { return pushDescriptor; }
+
+  // Number of descriptors update() and push() read, and the index of binding's first one
+  uint32_t getTemplateDescriptorCount() const { return templateDescriptorCount; }
+  uint32_t getTemplateOffset(uint32_t binding) const;
+  // Rewrites every descriptor of set in one call, through a descriptor update template created on
+  // first use when the device supports them. Meant for sets rewritten every frame.
+  void update(VkDescriptorSet set, const TemplateDescriptor *descriptors);
+  // Pushes every descriptor into commandBuffer as set number setIndex of pipelineLayout
+  void push(
+      VkCommandBuffer commandBuffer,
+      VkPipelineBindPoint bindPoint,
+      VkPipelineLayout pipelineLayout,
+      uint32_t setIndex,
+      const TemplateDescriptor *descriptors);
 
  private:
+  // fills templateWrites from descriptors
+  void prepareTemplateWrites(const TemplateDescriptor *descriptors);
+
   LveDevice &lveDevice;
   VkDescriptorSetLayout descriptorSetLayout;
   std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+  bool updateAfterBind = false;
+  bool pushDescriptor = false;
+
+  std::vector<VkDescriptorUpdateTemplateEntryKHR> templateEntries;  // in binding order
+  uint32_t templateDescriptorCount = 0;
+  VkDescriptorUpdateTemplateKHR updateTemplate = VK_NULL_HANDLE;
+  // reused by update() without update templates, and by push()
+  std::vector<VkWriteDescriptorSet> templateWrites;
 
   friend class LveDescriptorWriter;
 };
 
+// Shares one VkDescriptorSetLayout between all builders that describe the same bindings. Layouts
+// live as long as the cache.
+class LveDescriptorSetLayoutCache {
+ public:
+  LveDescriptorSetLayoutCache(LveDevice &lveDevice) : lveDevice{lveDevice} {}
+
+  LveDescriptorSetLayoutCache(const LveDescriptorSetLayoutCache &) = delete;
+  LveDescriptorSetLayoutCache &operator=(const LveDescriptorSetLayoutCache &) = delete;
+
+  std::shared_ptr<LveDescriptorSetLayout> getLayout(
+      const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+      const std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> &bindingFlags = {},
+      bool pushDescriptor = false);
+  size_t size() const { return layoutCount; }
+
+ private:
+  struct Entry {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;  // sorted by binding
+    std::vector<VkDescriptorBindingFlagsEXT> bindingFlags;
+    bool pushDescriptor;
+    std::shared_ptr<LveDescriptorSetLayout> layout;
+  };
+
+  LveDevice &lveDevice;
+  std::unordered_map<size_t, std::vector<Entry>> layouts;  // by hash of the sorted bindings
+  size_t layoutCount = 0;
+};
+
 class LveDescriptorPool {
  public:
   class Builder {
@@ -87,17 +167,72 @@ class LveDescriptorPool {
 class LveDescriptorWriter {
  public:
   LveDescriptorWriter(LveDescriptorSetLayout &setLayout, LveDescriptorPool &pool);
+  // sets are allocated for the current frame only, see LveDescriptorAllocator
+  LveDescriptorWriter(LveDescriptorSetLayout &setLayout, LveDescriptorAllocator &allocator);
 
-  LveDescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
-  LveDescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
+  // arrayElement selects the descriptor within an array binding
+  LveDescriptorWriter &writeBuffer(
+      uint32_t binding, VkDescriptorBufferInfo *bufferInfo, uint32_t arrayElement = 0);
+  LveDescriptorWriter &writeImage(
+      uint32_t binding, VkDescriptorImageInfo *imageInfo, uint32_t arrayElement = 0);
 
   bool build(VkDescriptorSet &set);
+  // returns the cached set with the same layout and descriptors, only allocating and writing a
+  // new set the first time
+  bool build(VkDescriptorSet &set, LveDescriptorSetCache &cache);
   void overwrite(VkDescriptorSet &set);
 
  private:
   LveDescriptorSetLayout &setLayout;
-  LveDescriptorPool &pool;
+  LveDescriptorPool *pool = nullptr;
+  LveDescriptorAllocator *allocator = nullptr;
   std::vector<VkWriteDescriptorSet> writes;
 };
 
+// Reuses descriptor sets written with the same layout and buffer/image infos, so per object and
+// material sets are allocated once instead of every frame. Sets stay owned by the pool they were
+// allocated from, clear the cache before that pool is reset or destroyed, and before a cached
+// buffer, image view or sampler is destroyed while its handle value could be reused.
+class LveDescriptorSetCache {
+ public:
+  struct Descriptor {
+    uint32_t binding = 0;
+    uint32_t arrayElement = 0;
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_SAMPLER;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize range = 0;
+    VkSampler sampler = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;
+    VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    bool operator==(const Descriptor &other) const;
+  };
+
+  struct Key {
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    std::vector<Descriptor> descriptors;  // sorted by binding and array element
+
+    bool operator==(const Key &other) const {
+      return layout == other.layout && descriptors == other.descriptors;
+    }
+  };
+
+  LveDescriptorSetCache() = default;
+  LveDescriptorSetCache(const LveDescriptorSetCache &) = delete;
+  LveDescriptorSetCache &operator=(const LveDescriptorSetCache &) = delete;
+
+  bool find(const Key &key, VkDescriptorSet &set) const;
+  void insert(Key key, VkDescriptorSet set);
+  void clear() { sets.clear(); }
+  size_t size() const { return sets.size(); }
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  std::unordered_map<Key, VkDescriptorSet, KeyHash> sets;
+};
+
 }  // namespace lve
@@ -1,11 +1,19 @@
 #include "lve_device.hpp"
 
 // std headers
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
 
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
 namespace lve {
 
 // local callback functions
@@ -54,9 +62,20 @@ LveDevice::LveDevice(LveWindow &window) : window{window} {
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  createPipelineCache();
+  allocator = std::make_unique<LveMemoryAllocator>(physicalDevice, device_);
+  selectDirectWriteLimit();
+  stagingRing_ = std::make_unique<LveStagingRing>(*this);
 }
 
 LveDevice::~LveDevice() {
+  savePipelineCache();
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
+  stagingRing_.reset();
+  allocator.reset();
+  if (transferCommandPool != commandPool) {
+    vkDestroyCommandPool(device_, transferCommandPool, nullptr);
+  }
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -86,6 +105,12 @@ void LveDevice::createInstance() {
   createInfo.pApplicationInfo = &appInfo;
 
   auto extensions = getRequiredExtensions();
+  // needed for VK_EXT_memory_budget on Vulkan 1.0
+  hasPhysicalDeviceProperties2 =
+      hasInstanceExtension(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+  if (hasPhysicalDeviceProperties2) {
+    extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+  }
   createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
   createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -138,6 +163,9 @@ void LveDevice::createLogicalDevice() {
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+  if (indices.transferFamilyHasValue) {
+    uniqueQueueFamilies.insert(indices.transferFamily);
+  }
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -159,8 +187,46 @@ void LveDevice::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+  // the memory budget is optional, without it budgets are estimated from the heap sizes
+  std::vector<const char *> enabledExtensions = deviceExtensions;
+  bool memoryBudgetSupported =
+      hasPhysicalDeviceProperties2 &&
+      hasDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  if (memoryBudgetSupported) {
+    enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
+
+  // bindless descriptors are optional as well, only the features they use are enabled
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+  descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  descriptorIndexingSupported = checkDescriptorIndexingSupport();
+  if (descriptorIndexingSupported) {
+    enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+    enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    // the storage buffer arrays are indexed with push constants
+    deviceFeatures.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    createInfo.pNext = &descriptorIndexingFeatures;
+  }
+  bool updateTemplateSupported =
+      hasDeviceExtension(physicalDevice, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+  if (updateTemplateSupported) {
+    enabledExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+  }
+  bool pushDescriptorSupported =
+      hasPhysicalDeviceProperties2 &&
+      hasDeviceExtension(physicalDevice, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+  if (pushDescriptorSupported) {
+    enabledExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+  }
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -175,8 +241,43 @@ void LveDevice::createLogicalDevice() {
     throw std::runtime_error("failed to create logical device!");
   }
 
+  if (memoryBudgetSupported) {
+    getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(
+        instance,
+        "vkGetPhysicalDeviceMemoryProperties2KHR");
+  }
+
+  if (updateTemplateSupported) {
+    descriptorFunctions_.createUpdateTemplate =
+        (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(
+            device_,
+            "vkCreateDescriptorUpdateTemplateKHR");
+    descriptorFunctions_.destroyUpdateTemplate =
+        (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(
+            device_,
+            "vkDestroyDescriptorUpdateTemplateKHR");
+    descriptorFunctions_.updateWithTemplate =
+        (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(
+            device_,
+            "vkUpdateDescriptorSetWithTemplateKHR");
+  }
+  if (pushDescriptorSupported) {
+    descriptorFunctions_.pushDescriptorSet = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(
+        device_,
+        "vkCmdPushDescriptorSetKHR");
+  }
+
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+  graphicsQueueFamily_ = indices.graphicsFamily;
+  if (indices.transferFamilyHasValue) {
+    vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+    transferQueueFamily_ = indices.transferFamily;
+  } else {
+    transferQueue_ = graphicsQueue_;
+    transferQueueFamily_ = indices.graphicsFamily;
+  }
 }
 
 void LveDevice::createCommandPool() {
@@ -191,6 +292,94 @@ void LveDevice::createCommandPool() {
   if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
     throw std::runtime_error("failed to create command pool!");
   }
+
+  transferCommandPool = commandPool;
+  if (transferQueueFamily_ != graphicsQueueFamily_) {
+    poolInfo.queueFamilyIndex = transferQueueFamily_;
+    if (vkCreateCommandPool(device_, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create transfer command pool!");
+    }
+  }
+}
+
+void LveDevice::createPipelineCache() {
+  // a missing, truncated or foreign cache file just means starting with an empty cache
+  std::vector<char> data{};
+  std::string cachePath = ENGINE_DIR + std::string{PIPELINE_CACHE_FILE};
+  std::ifstream file{cachePath, std::ios::ate | std::ios::binary};
+  if (file.is_open()) {
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    if (!file || !isPipelineCacheCompatible(data)) {
+      data.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+  VkResult result = vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_);
+  if (result != VK_SUCCESS && !data.empty()) {
+    // the driver rejected the data after all
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = nullptr;
+    result = vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_);
+  }
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+}
+
+bool LveDevice::isPipelineCacheCompatible(const std::vector<char> &data) {
+  // VkPipelineCacheHeaderVersionOne: header size, header version, vendor ID, device ID and the
+  // pipeline cache UUID, which changes with the driver version
+  constexpr size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+  if (data.size() < headerSize) {
+    return false;
+  }
+
+  uint32_t header[4];
+  std::memcpy(header, data.data(), sizeof(header));
+  return header[0] >= headerSize && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header[2] == properties.vendorID && header[3] == properties.deviceID &&
+         std::memcmp(
+             data.data() + sizeof(header),
+             properties.pipelineCacheUUID,
+             VK_UUID_SIZE) == 0;
+}
+
+void LveDevice::savePipelineCache() {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &size, nullptr) != VK_SUCCESS) {
+    return;
+  }
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &size, data.data()) != VK_SUCCESS) {
+    return;
+  }
+
+  // write next to the old file and swap them, so an interrupted write never leaves a bad cache
+  std::string cachePath = ENGINE_DIR + std::string{PIPELINE_CACHE_FILE};
+  std::string tempPath = cachePath + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      std::cerr << "failed to write pipeline cache: " << tempPath << std::endl;
+      return;
+    }
+    file.write(data.data(), size);
+    if (!file) {
+      std::cerr << "failed to write pipeline cache: " << tempPath << std::endl;
+      return;
+    }
+  }
+  std::remove(cachePath.c_str());
+  if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+    std::cerr << "failed to write pipeline cache: " << cachePath << std::endl;
+  }
 }
 
 void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
@@ -296,6 +485,79 @@ void LveDevice::hasGflwRequiredInstanceExtensions() {
   }
 }
 
+bool LveDevice::hasInstanceExtension(const char *name) {
+  uint32_t extensionCount = 0;
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+  for (const auto &extension : extensions) {
+    if (std::strcmp(extension.extensionName, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LveDevice::hasDeviceExtension(VkPhysicalDevice device, const char *name) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+  for (const auto &extension : extensions) {
+    if (std::strcmp(extension.extensionName, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LveDevice::checkDescriptorIndexingSupport() {
+  if (!hasPhysicalDeviceProperties2 ||
+      !hasDeviceExtension(physicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME) ||
+      !hasDeviceExtension(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+    return false;
+  }
+
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  if (!supportedFeatures.shaderStorageBufferArrayDynamicIndexing) {
+    return false;
+  }
+
+  auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(
+      instance,
+      "vkGetPhysicalDeviceFeatures2KHR");
+  auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(
+      instance,
+      "vkGetPhysicalDeviceProperties2KHR");
+  if (getFeatures2 == nullptr || getProperties2 == nullptr) {
+    return false;
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+  indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  VkPhysicalDeviceFeatures2KHR features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &indexingFeatures;
+  getFeatures2(physicalDevice, &features2);
+
+  descriptorIndexingProperties.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  VkPhysicalDeviceProperties2KHR properties2{};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &descriptorIndexingProperties;
+  getProperties2(physicalDevice, &properties2);
+
+  return indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+         indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+         indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+         indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+         indexingFeatures.descriptorBindingPartiallyBound &&
+         indexingFeatures.runtimeDescriptorArray;
+}
+
 bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   uint32_t extensionCount;
   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -344,6 +606,19 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
     i++;
   }
 
+  // prefer a transfer only family, usually backed by a copy engine that runs alongside graphics
+  for (uint32_t family = 0; family < queueFamilyCount; family++) {
+    VkQueueFlags flags = queueFamilies[family].queueFlags;
+    if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) ||
+        (flags & VK_QUEUE_GRAPHICS_BIT)) {
+      continue;
+    }
+    if (!indices.transferFamilyHasValue || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+      indices.transferFamily = family;
+      indices.transferFamilyHasValue = true;
+    }
+  }
+
   return indices;
 }
 
@@ -390,16 +665,44 @@ VkFormat LveDevice::findSupportedFormat(
 }
 
 uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-  VkPhysicalDeviceMemoryProperties memProperties;
-  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  return allocator->findMemoryType(typeFilter, properties);
+}
+
+void LveDevice::selectDirectWriteLimit() {
+  // host visible device local memory is either all of VRAM with resizable BAR, or a 256 MiB window
+  // that must also hold everything else placed there
+  const VkPhysicalDeviceMemoryProperties &memProperties = allocator->getMemoryProperties();
+  constexpr VkMemoryPropertyFlags BAR_PROPERTIES =
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  directWriteLimit = 0;
   for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-    if ((typeFilter & (1 << i)) &&
-        (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-      return i;
-    }
+    if ((memProperties.memoryTypes[i].propertyFlags & BAR_PROPERTIES) != BAR_PROPERTIES) continue;
+    VkDeviceSize heapSize = memProperties.memoryHeaps[memProperties.memoryTypes[i].heapIndex].size;
+    directWriteLimit = std::max(directWriteLimit, std::min(MAX_DIRECT_WRITE_SIZE, heapSize / 64));
   }
+}
 
-  throw std::runtime_error("failed to find suitable memory type!");
+void LveDevice::destroyDeferred(std::function<void()> destroy) {
+  if (deferredDestroyHandler) {
+    deferredDestroyHandler(std::move(destroy));
+  } else {
+    destroy();
+  }
+}
+
+void LveDevice::registerMovableBuffer(LveBuffer *buffer) {
+  std::lock_guard<std::mutex> lock{movableBuffersMutex};
+  movableBuffers.insert(buffer);
+}
+
+void LveDevice::unregisterMovableBuffer(LveBuffer *buffer) {
+  std::lock_guard<std::mutex> lock{movableBuffersMutex};
+  movableBuffers.erase(buffer);
+}
+
+std::vector<LveBuffer *> LveDevice::getMovableBuffers() {
+  std::lock_guard<std::mutex> lock{movableBuffersMutex};
+  return {movableBuffers.begin(), movableBuffers.end()};
 }
 
 void LveDevice::createBuffer(
@@ -407,7 +710,7 @@ void LveDevice::createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    LveMemoryAllocator::Allocation &bufferMemory) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -421,16 +724,17 @@ void LveDevice::createBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
+  LveMemoryAllocator::MemoryCategory category = LveMemoryAllocator::MEMORY_CATEGORY_OTHER;
+  if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+    category = LveMemoryAllocator::MEMORY_CATEGORY_GEOMETRY;
+  } else if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+    category = LveMemoryAllocator::MEMORY_CATEGORY_UNIFORMS;
+  } else if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+    category = LveMemoryAllocator::MEMORY_CATEGORY_STAGING;
   }
 
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+  bufferMemory = allocator->allocate(memRequirements, properties, true, category);
+  vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 VkCommandBuffer LveDevice::beginSingleTimeCommands() {
@@ -459,9 +763,18 @@ void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  // wait for this submission only, not for frames already queued
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create fence!");
+  }
+
+  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+  vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
 
+  vkDestroyFence(device_, fence, nullptr);
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
 
@@ -508,7 +821,7 @@ void LveDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    LveMemoryAllocator::Allocation &imageMemory) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -516,18 +829,88 @@ void LveDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
+  LveMemoryAllocator::MemoryCategory category = LveMemoryAllocator::MEMORY_CATEGORY_OTHER;
+  if (imageInfo.usage &
+      (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) {
+    category = LveMemoryAllocator::MEMORY_CATEGORY_ATTACHMENTS;
   }
 
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+  imageMemory = allocator->allocate(
+      memRequirements,
+      properties,
+      imageInfo.tiling == VK_IMAGE_TILING_LINEAR,
+      category);
+  if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
 
-}  // namespace lve
\ No newline at end of file
+MemoryBudget LveDevice::getMemoryBudget() {
+  const VkPhysicalDeviceMemoryProperties &memProperties = allocator->getMemoryProperties();
+  MemoryBudget memoryBudget{};
+  memoryBudget.heapCount = memProperties.memoryHeapCount;
+
+  if (getMemoryProperties2 != nullptr) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2KHR memProperties2{};
+    memProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memProperties2.pNext = &budgetProperties;
+    getMemoryProperties2(physicalDevice, &memProperties2);
+
+    for (uint32_t i = 0; i < memoryBudget.heapCount; i++) {
+      memoryBudget.budget[i] = budgetProperties.heapBudget[i];
+      memoryBudget.usage[i] = budgetProperties.heapUsage[i];
+    }
+    memoryBudget.fromDriver = true;
+    return memoryBudget;
+  }
+
+  LveMemoryAllocator::Stats stats = allocator->getStats();
+  for (uint32_t i = 0; i < memoryBudget.heapCount; i++) {
+    memoryBudget.budget[i] =
+        static_cast<VkDeviceSize>(memProperties.memoryHeaps[i].size * ESTIMATED_BUDGET_FRACTION);
+    memoryBudget.usage[i] = stats.heapBytes[i];
+  }
+  return memoryBudget;
+}
+
+VkDeviceSize LveDevice::getMemoryOverBudget(float fraction) {
+  const VkPhysicalDeviceMemoryProperties &memProperties = allocator->getMemoryProperties();
+  MemoryBudget memoryBudget = getMemoryBudget();
+
+  VkDeviceSize overBudget = 0;
+  for (uint32_t i = 0; i < memoryBudget.heapCount; i++) {
+    if (!(memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+    auto limit = static_cast<VkDeviceSize>(memoryBudget.budget[i] * fraction);
+    if (memoryBudget.usage[i] > limit) {
+      overBudget = std::max(overBudget, memoryBudget.usage[i] - limit);
+    }
+  }
+  return overBudget;
+}
+
+void LveDevice::printMemoryReport(std::ostream &out) {
+  constexpr double MIB = 1024. * 1024.;
+  const VkPhysicalDeviceMemoryProperties &memProperties = allocator->getMemoryProperties();
+  LveMemoryAllocator::Stats stats = allocator->getStats();
+  MemoryBudget memoryBudget = getMemoryBudget();
+
+  out << "device memory: " << stats.blockCount << " blocks (" << stats.blockBytes / MIB
+      << " MiB), " << stats.dedicatedAllocationCount << " dedicated (" << stats.dedicatedBytes / MIB
+      << " MiB), " << stats.allocationCount << " sub-allocations, fragmentation "
+      << stats.fragmentation << std::endl;
+  for (int i = 0; i < LveMemoryAllocator::MEMORY_CATEGORY_COUNT; i++) {
+    auto category = static_cast<LveMemoryAllocator::MemoryCategory>(i);
+    out << "\t" << LveMemoryAllocator::categoryName(category) << ": "
+        << stats.categoryBytes[i] / MIB << " MiB" << std::endl;
+  }
+  for (uint32_t i = 0; i < memoryBudget.heapCount; i++) {
+    bool deviceLocal = memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    out << "\theap " << i << (deviceLocal ? " (device local)" : "") << ": "
+        << memoryBudget.usage[i] / MIB << " / " << memoryBudget.budget[i] / MIB << " MiB"
+        << (memoryBudget.fromDriver ? "" : " (estimated budget)") << std::endl;
+  }
+}
+
+}  // namespace lve
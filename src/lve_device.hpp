@@ -1,13 +1,23 @@
 #pragma once
 
+#include "lve_memory_allocator.hpp"
+#include "lve_staging_ring.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace lve {
 
+class LveBuffer;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -17,11 +27,22 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  uint32_t transferFamily;  // family without graphics support, optional
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+struct MemoryBudget {
+  uint32_t heapCount = 0;
+  // What the process may allocate from each heap and what it has allocated. Without
+  // VK_EXT_memory_budget these are estimated from the heap sizes and this device's allocations.
+  std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> budget{};
+  std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> usage{};
+  bool fromDriver = false;
+};
+
 class LveDevice {
  public:
 #ifdef NDEBUG
@@ -29,6 +50,13 @@ class LveDevice {
 #else
   const bool enableValidationLayers = true;
 #endif
+  // share of a heap's budget assumed available when the driver does not report one
+  static constexpr float ESTIMATED_BUDGET_FRACTION = .8f;
+  // largest buffer written directly into host visible VRAM, see prefersDirectWrite
+  static constexpr VkDeviceSize MAX_DIRECT_WRITE_SIZE = 16ull << 20;
+  // relative to ENGINE_DIR like shaders and models, holds the driver's compiled pipelines between
+  // runs
+  static constexpr const char *PIPELINE_CACHE_FILE = "pipeline_cache.bin";
 
   LveDevice(LveWindow &window);
   ~LveDevice();
@@ -40,10 +68,21 @@ class LveDevice {
   LveDevice &operator=(LveDevice &&) = delete;
 
   VkCommandPool getCommandPool() { return commandPool; }
+  // Shared by all pipelines, loaded from PIPELINE_CACHE_FILE if it was written by the same device
+  // and driver, and saved back on destruction
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
+  void savePipelineCache();
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // Dedicated transfer queue if the device has one, otherwise the graphics queue. Resources
+  // written on a dedicated transfer queue need an ownership transfer to the graphics family.
+  VkQueue transferQueue() { return transferQueue_; }
+  VkCommandPool getTransferCommandPool() { return transferCommandPool; }
+  bool hasDedicatedTransferQueue() { return transferCommandPool != commandPool; }
+  uint32_t graphicsQueueFamily() { return graphicsQueueFamily_; }
+  uint32_t transferQueueFamily() { return transferQueueFamily_; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -57,7 +96,7 @@ class LveDevice {
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      LveMemoryAllocator::Allocation &bufferMemory);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -68,7 +107,53 @@ class LveDevice {
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      LveMemoryAllocator::Allocation &imageMemory);
+  // Releases memory from createBuffer or createImageWithInfo, destroy the resource first
+  void freeMemory(LveMemoryAllocator::Allocation &memory) { allocator->free(memory); }
+  // Runs destroy once frames in flight can no longer use the resource it destroys, or right away
+  // when no handler such as LveRenderer is set
+  void destroyDeferred(std::function<void()> destroy);
+  void setDeferredDestroyHandler(std::function<void(std::function<void()>)> handler) {
+    deferredDestroyHandler = std::move(handler);
+  }
+  // buffers LveDefragmenter may relocate, see LveBuffer::setMovable
+  void registerMovableBuffer(LveBuffer *buffer);
+  void unregisterMovableBuffer(LveBuffer *buffer);
+  std::vector<LveBuffer *> getMovableBuffers();
+  LveMemoryAllocator &memoryAllocator() { return *allocator; }
+  LveMemoryAllocator::Stats getMemoryStats() const { return allocator->getStats(); }
+  const VkPhysicalDeviceMemoryProperties &getMemoryProperties() const {
+    return allocator->getMemoryProperties();
+  }
+  MemoryBudget getMemoryBudget();
+  // Bytes allocated beyond fraction of the budget of the most used device local heap, 0 if none
+  VkDeviceSize getMemoryOverBudget(float fraction);
+  void printMemoryReport(std::ostream &out);
+  // True if a buffer of size bytes the host writes and the device reads should be placed in host
+  // visible device local memory (resizable BAR) and written directly, skipping the staging copy
+  bool prefersDirectWrite(VkDeviceSize size) const {
+    return directWriteLimit > 0 && size <= directWriteLimit;
+  }
+  // staging memory for host to device uploads, see LveUploadBatch
+  LveStagingRing &stagingRing() { return *stagingRing_; }
+  // True if VK_EXT_descriptor_indexing is enabled with the features LveBindlessDescriptors needs
+  bool supportsDescriptorIndexing() const { return descriptorIndexingSupported; }
+  const VkPhysicalDeviceDescriptorIndexingPropertiesEXT &getDescriptorIndexingProperties() const {
+    return descriptorIndexingProperties;
+  }
+  // Entry points of VK_KHR_descriptor_update_template and VK_KHR_push_descriptor, null when the
+  // device does not support the extension
+  struct DescriptorFunctions {
+    PFN_vkCreateDescriptorUpdateTemplateKHR createUpdateTemplate = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR destroyUpdateTemplate = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR updateWithTemplate = nullptr;
+    PFN_vkCmdPushDescriptorSetKHR pushDescriptorSet = nullptr;
+  };
+  const DescriptorFunctions &descriptorFunctions() const { return descriptorFunctions_; }
+  bool supportsDescriptorUpdateTemplates() const {
+    return descriptorFunctions_.createUpdateTemplate != nullptr;
+  }
+  bool supportsPushDescriptors() const { return descriptorFunctions_.pushDescriptorSet != nullptr; }
 
   VkPhysicalDeviceProperties properties;
 
@@ -79,6 +164,8 @@ class LveDevice {
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void createPipelineCache();
+  void selectDirectWriteLimit();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -88,6 +175,10 @@ class LveDevice {
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool hasInstanceExtension(const char *name);
+  bool hasDeviceExtension(VkPhysicalDevice device, const char *name);
+  bool checkDescriptorIndexingSupport();
+  bool isPipelineCacheCompatible(const std::vector<char> &data);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
@@ -95,11 +186,28 @@ class LveDevice {
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   LveWindow &window;
   VkCommandPool commandPool;
+  VkCommandPool transferCommandPool;
+  VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
 
   VkDevice device_;
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  uint32_t graphicsQueueFamily_;
+  uint32_t transferQueueFamily_;
+  std::unique_ptr<LveMemoryAllocator> allocator;
+  std::unique_ptr<LveStagingRing> stagingRing_;
+  VkDeviceSize directWriteLimit = 0;
+  std::function<void(std::function<void()>)> deferredDestroyHandler;
+  std::mutex movableBuffersMutex;
+  std::unordered_set<LveBuffer *> movableBuffers;
+  // set when VK_EXT_memory_budget is enabled
+  PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+  bool hasPhysicalDeviceProperties2 = false;
+  bool descriptorIndexingSupported = false;
+  VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties{};
+  DescriptorFunctions descriptorFunctions_{};
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -0,0 +1,68 @@
+#include "lve_frame_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+LveFrameAllocator::LveFrameAllocator(LveDevice &device, VkDeviceSize frameSize, int frameCount)
+    : lveDevice{device}, frameSize{frameSize} {
+  const VkPhysicalDeviceLimits &limits = lveDevice.properties.limits;
+  alignment = std::max(
+      limits.minUniformBufferOffsetAlignment,
+      limits.minStorageBufferOffsetAlignment);
+
+  // the device reads this data every frame, so keep it in VRAM when the host can write there
+  VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  if (lveDevice.prefersDirectWrite(frameSize)) {
+    memoryProperties |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  }
+
+  buffers.resize(frameCount);
+  for (auto &buffer : buffers) {
+    buffer = std::make_unique<LveBuffer>(
+        lveDevice,
+        frameSize,
+        1,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        memoryProperties);
+    if (buffer->map() != VK_SUCCESS) {
+      throw std::runtime_error("failed to map frame allocator buffer!");
+    }
+  }
+}
+
+void LveFrameAllocator::beginFrame(int frameIndex) {
+  assert(frameIndex >= 0 && frameIndex < buffers.size() && "Frame index out of range");
+  currentFrame = frameIndex;
+  head = 0;
+}
+
+void LveFrameAllocator::flush() {
+  assert(currentFrame >= 0 && "Cannot flush frame allocator before beginFrame");
+  if (head > 0) {
+    buffers[currentFrame]->flush(head);
+  }
+}
+
+LveFrameAllocator::Allocation LveFrameAllocator::allocate(VkDeviceSize size) {
+  assert(currentFrame >= 0 && "Cannot allocate from frame allocator before beginFrame");
+
+  VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+  if (offset + size > frameSize) {
+    throw std::runtime_error("failed to allocate frame memory!");
+  }
+  head = offset + size;
+
+  LveBuffer &buffer = *buffers[currentFrame];
+  Allocation allocation{};
+  allocation.buffer = buffer.getBuffer();
+  allocation.offset = static_cast<uint32_t>(offset);
+  allocation.size = size;
+  allocation.mapped = static_cast<char *>(buffer.getMappedMemory()) + offset;
+  return allocation;
+}
+
+}  // namespace lve
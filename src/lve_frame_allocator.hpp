@@ -0,0 +1,72 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// Linear allocator for transient uniform and storage data written once per frame. Every frame in
+// flight owns a persistently mapped buffer that allocations bump through, and that is reset once
+// the frame's fence has signaled, so per frame data never allocates or maps memory. Allocations
+// are bound through dynamic descriptors pointing at the frame's buffer, with the allocation offset
+// passed as the dynamic offset.
+class LveFrameAllocator {
+ public:
+  static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 4ull << 20;
+
+  struct Allocation {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    uint32_t offset = 0;  // dynamic offset of the allocation
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;
+  };
+
+  LveFrameAllocator(
+      LveDevice &device,
+      VkDeviceSize frameSize = DEFAULT_FRAME_SIZE,
+      int frameCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+  LveFrameAllocator(const LveFrameAllocator &) = delete;
+  LveFrameAllocator &operator=(const LveFrameAllocator &) = delete;
+
+  // Starts allocating from the buffer of frameIndex. Only call once the frame's previous
+  // submission has finished, which LveRenderer::beginFrame ensures.
+  void beginFrame(int frameIndex);
+  // Makes this frame's writes visible to the device, call before the frame is submitted
+  void flush();
+
+  // Offsets are aligned for both uniform and storage buffer descriptors
+  Allocation allocate(VkDeviceSize size);
+  template <typename T>
+  uint32_t write(const T &data) {
+    Allocation allocation = allocate(sizeof(T));
+    std::memcpy(allocation.mapped, &data, sizeof(T));
+    return allocation.offset;
+  }
+
+  // Descriptor for a dynamic binding of range bytes into the buffer of frameIndex
+  VkDescriptorBufferInfo descriptorInfo(int frameIndex, VkDeviceSize range) {
+    return buffers[frameIndex]->descriptorInfo(range, 0);
+  }
+
+  VkDeviceSize getFrameSize() const { return frameSize; }
+  VkDeviceSize getAlignment() const { return alignment; }
+  VkDeviceSize getUsedSize() const { return head; }
+
+ private:
+  LveDevice &lveDevice;
+  VkDeviceSize frameSize;
+  VkDeviceSize alignment;
+  std::vector<std::unique_ptr<LveBuffer>> buffers;
+
+  int currentFrame = -1;
+  VkDeviceSize head = 0;
+};
+
+}  // namespace lve
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "lve_camera.hpp"
+#include "lve_descriptor_allocator.hpp"
+#include "lve_frame_allocator.hpp"
 #include "lve_game_object.hpp"
 
 // lib
@@ -31,5 +33,10 @@ struct FrameInfo {
   LveCamera &camera;
   VkDescriptorSet globalDescriptorSet;
   LveGameObject::Map &gameObjects;
+  // transient data for this frame, bound with dynamic offsets
+  LveFrameAllocator &frameAllocator;
+  uint32_t globalUboOffset;
+  // descriptor sets that only live for this frame
+  LveDescriptorAllocator &descriptorAllocator;
 };
 }  // namespace lve
@@ -53,6 +53,9 @@ class LveGameObject {
 
   // Optional pointer components
   std::shared_ptr<LveModel> model{};
+  uint32_t modelLod = 0;  // LOD of model drawn last frame, see LveModel::selectLod
+  // texture sampled by the bindless shaders, ~0u for none, see LveBindlessDescriptors
+  uint32_t textureIndex = ~0u;
   std::unique_ptr<PointLightComponent> pointLight = nullptr;
 
  private:
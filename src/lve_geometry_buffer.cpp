@@ -0,0 +1,112 @@
+#include "lve_geometry_buffer.hpp"
+
+// std
+#include <cassert>
+#include <iterator>
+
+namespace lve {
+
+LveGeometryBuffer::LveGeometryBuffer(
+    LveDevice &device,
+    LveModel::VertexFormat vertexFormat,
+    uint32_t vertexCapacity,
+    uint32_t indexCapacity)
+    : vertexFormat{vertexFormat}, freeVertices{vertexCapacity}, freeIndices{indexCapacity} {
+  uint32_t vertexSize = vertexFormat == LveModel::VERTEX_FORMAT_COMPACT
+                            ? sizeof(LveModel::CompactVertex)
+                            : sizeof(LveModel::Vertex);
+  vertexBuffer = std::make_unique<LveBuffer>(
+      device,
+      vertexSize,
+      vertexCapacity,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  indexBuffer = std::make_unique<LveBuffer>(
+      device,
+      sizeof(uint32_t),
+      indexCapacity,
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+bool LveGeometryBuffer::allocate(
+    uint32_t vertexCount, uint32_t indexCount, Allocation &allocation) {
+  Allocation result{};
+  result.vertexCount = vertexCount;
+  result.indexCount = indexCount;
+
+  if (!freeVertices.allocate(vertexCount, result.vertexOffset)) {
+    return false;
+  }
+  if (!freeIndices.allocate(indexCount, result.firstIndex)) {
+    freeVertices.free(result.vertexOffset, vertexCount);
+    return false;
+  }
+  allocation = result;
+  return true;
+}
+
+void LveGeometryBuffer::free(const Allocation &allocation) {
+  freeVertices.free(allocation.vertexOffset, allocation.vertexCount);
+  freeIndices.free(allocation.firstIndex, allocation.indexCount);
+}
+
+void LveGeometryBuffer::bind(VkCommandBuffer commandBuffer) {
+  VkBuffer buffers[] = {vertexBuffer->getBuffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+  vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+LveGeometryBuffer::FreeList::FreeList(uint32_t capacity) : available{capacity} {
+  if (capacity > 0) {
+    ranges[0] = capacity;
+  }
+}
+
+bool LveGeometryBuffer::FreeList::allocate(uint32_t count, uint32_t &offset) {
+  if (count == 0) {
+    offset = 0;
+    return true;
+  }
+
+  for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+    if (it->second < count) continue;
+
+    offset = it->first;
+    uint32_t remaining = it->second - count;
+    ranges.erase(it);
+    if (remaining > 0) {
+      ranges[offset + count] = remaining;
+    }
+    available -= count;
+    return true;
+  }
+  return false;
+}
+
+void LveGeometryBuffer::FreeList::free(uint32_t offset, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  auto next = ranges.lower_bound(offset);
+  assert((next == ranges.end() || offset + count <= next->first) && "Range freed twice");
+
+  auto inserted = ranges.emplace_hint(next, offset, count);
+  if (next != ranges.end() && offset + count == next->first) {
+    inserted->second += next->second;
+    ranges.erase(next);
+  }
+  if (inserted != ranges.begin()) {
+    auto previous = std::prev(inserted);
+    assert(previous->first + previous->second <= offset && "Range freed twice");
+    if (previous->first + previous->second == offset) {
+      previous->second += inserted->second;
+      ranges.erase(inserted);
+    }
+  }
+  available += count;
+}
+
+}  // namespace lve
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+#include "lve_model.hpp"
+
+// std
+#include <map>
+#include <memory>
+
+namespace lve {
+
+// One device local vertex buffer and one 32 bit index buffer that many models sub-allocate their
+// geometry from. Models drawn from the same geometry buffer share a single vertex and index buffer
+// binding and address their data through vertexOffset and firstIndex instead.
+class LveGeometryBuffer {
+ public:
+  // Ranges are in vertices and indices, not bytes
+  struct Allocation {
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+  };
+
+  LveGeometryBuffer(
+      LveDevice &device,
+      LveModel::VertexFormat vertexFormat,
+      uint32_t vertexCapacity,
+      uint32_t indexCapacity);
+
+  LveGeometryBuffer(const LveGeometryBuffer &) = delete;
+  LveGeometryBuffer &operator=(const LveGeometryBuffer &) = delete;
+
+  // Returns false if either range does not fit
+  bool allocate(uint32_t vertexCount, uint32_t indexCount, Allocation &allocation);
+  // The caller must make sure the GPU is done reading the range before it is written again
+  void free(const Allocation &allocation);
+
+  void bind(VkCommandBuffer commandBuffer);
+
+  LveModel::VertexFormat getVertexFormat() const { return vertexFormat; }
+  VkDeviceSize getVertexStride() const { return vertexBuffer->getInstanceSize(); }
+  VkBuffer getVertexBuffer() const { return vertexBuffer->getBuffer(); }
+  VkBuffer getIndexBuffer() const { return indexBuffer->getBuffer(); }
+  uint32_t getFreeVertexCount() const { return freeVertices.freeCount(); }
+  uint32_t getFreeIndexCount() const { return freeIndices.freeCount(); }
+
+ private:
+  // First fit allocator over [0, capacity), adjacent free ranges are merged
+  class FreeList {
+   public:
+    explicit FreeList(uint32_t capacity);
+
+    bool allocate(uint32_t count, uint32_t &offset);
+    void free(uint32_t offset, uint32_t count);
+    uint32_t freeCount() const { return available; }
+
+   private:
+    std::map<uint32_t, uint32_t> ranges;  // offset to count of each free range
+    uint32_t available;
+  };
+
+  LveModel::VertexFormat vertexFormat;
+  std::unique_ptr<LveBuffer> vertexBuffer;
+  std::unique_ptr<LveBuffer> indexBuffer;
+  FreeList freeVertices;
+  FreeList freeIndices;
+};
+
+}  // namespace lve
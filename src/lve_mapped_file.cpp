@@ -0,0 +1,114 @@
+#include "lve_mapped_file.hpp"
+
+// std
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lve {
+
+#ifdef _WIN32
+
+LveMappedFile::LveMappedFile(const std::string &filepath) {
+  HANDLE file = CreateFileA(
+      filepath.c_str(),
+      GENERIC_READ,
+      FILE_SHARE_READ,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+  fileHandle = file;
+
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw std::runtime_error("failed to query file size: " + filepath);
+  }
+  fileSize = static_cast<size_t>(size.QuadPart);
+
+  // zero length files cannot be mapped, leave data() as nullptr
+  if (fileSize == 0) {
+    return;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    throw std::runtime_error("failed to create file mapping: " + filepath);
+  }
+  mappingHandle = mapping;
+
+  mapped = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (mapped == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("failed to map file: " + filepath);
+  }
+}
+
+LveMappedFile::~LveMappedFile() {
+  if (mapped) {
+    UnmapViewOfFile(mapped);
+  }
+  if (mappingHandle) {
+    CloseHandle(static_cast<HANDLE>(mappingHandle));
+  }
+  if (fileHandle) {
+    CloseHandle(static_cast<HANDLE>(fileHandle));
+  }
+}
+
+#else
+
+LveMappedFile::LveMappedFile(const std::string &filepath) {
+  fileDescriptor = open(filepath.c_str(), O_RDONLY);
+  if (fileDescriptor < 0) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+
+  struct stat fileStat {};
+  if (fstat(fileDescriptor, &fileStat) != 0) {
+    close(fileDescriptor);
+    throw std::runtime_error("failed to query file size: " + filepath);
+  }
+  fileSize = static_cast<size_t>(fileStat.st_size);
+
+  // zero length files cannot be mapped, leave data() as nullptr
+  if (fileSize == 0) {
+    return;
+  }
+
+  void *address = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+  if (address == MAP_FAILED) {
+    close(fileDescriptor);
+    throw std::runtime_error("failed to map file: " + filepath);
+  }
+  madvise(address, fileSize, MADV_SEQUENTIAL);
+  mapped = static_cast<const char *>(address);
+}
+
+LveMappedFile::~LveMappedFile() {
+  if (mapped) {
+    munmap(const_cast<char *>(mapped), fileSize);
+  }
+  if (fileDescriptor >= 0) {
+    close(fileDescriptor);
+  }
+}
+
+#endif
+
+}  // namespace lve
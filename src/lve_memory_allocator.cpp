@@ -0,0 +1,579 @@
+#include "lve_memory_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace lve {
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// bit scans, value must not be 0
+uint32_t floorLog2(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return index;
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+uint32_t lowestBit(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+uint32_t lowestBit(uint32_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return index;
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+}  // namespace
+
+// TLSF allocator over one VkDeviceMemory. Free ranges are kept in lists by size class, the first
+// level is the power of two and the second level splits each power of two into SL_COUNT classes.
+// Bitmaps of the non empty lists make finding a large enough range two bit scans.
+class LveMemoryAllocator::Block {
+ public:
+  Block(VkDeviceMemory memory, VkDeviceSize size, void *mapped)
+      : memory{memory}, size{size}, mapped{mapped} {
+    nodes.push_back({0, size, 0, NONE, NONE, NONE, NONE, true});
+    insertFree(0);
+  }
+
+  bool allocate(
+      VkDeviceSize allocSize,
+      VkDeviceSize alignment,
+      VkDeviceSize wasted,
+      VkDeviceSize &offset,
+      uint32_t &node);
+  void free(uint32_t node);
+
+  VkDeviceSize largestFreeRange() const;
+  bool empty() const { return allocationCount == 0; }
+
+  const VkDeviceMemory memory;
+  const VkDeviceSize size;
+  void *const mapped;
+
+  uint32_t allocationCount = 0;
+  VkDeviceSize usedBytes = 0;
+  VkDeviceSize wastedBytes = 0;
+
+ private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+  static constexpr uint32_t SL_BITS = 4;
+  static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+  static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+  struct Node {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    VkDeviceSize wasted;
+    uint32_t prevPhysical;
+    uint32_t nextPhysical;
+    uint32_t prevFree;
+    uint32_t nextFree;
+    bool free;
+  };
+
+  static void mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl) {
+    if (size < SL_COUNT) {
+      fl = 0;
+      sl = static_cast<uint32_t>(size);
+      return;
+    }
+    uint32_t log2 = floorLog2(size);
+    fl = log2 - SL_BITS + 1;
+    sl = static_cast<uint32_t>(size >> (log2 - SL_BITS)) - SL_COUNT;
+  }
+
+  uint32_t findFree(VkDeviceSize minSize) const;
+  void insertFree(uint32_t node);
+  void removeFree(uint32_t node);
+  uint32_t createNode(const Node &node);
+  void releaseNode(uint32_t node);
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> unusedNodes;
+  uint64_t flBitmap = 0;
+  uint32_t slBitmaps[FL_COUNT] = {};
+  uint32_t freeLists[FL_COUNT][SL_COUNT];
+};
+
+bool LveMemoryAllocator::Block::allocate(
+    VkDeviceSize allocSize,
+    VkDeviceSize alignment,
+    VkDeviceSize wasted,
+    VkDeviceSize &offset,
+    uint32_t &node) {
+  // any range in the found list fits even after aligning its start
+  uint32_t found = findFree(allocSize + alignment - 1);
+  if (found == NONE) {
+    return false;
+  }
+  removeFree(found);
+
+  VkDeviceSize alignedOffset = alignUp(nodes[found].offset, alignment);
+  VkDeviceSize padding = alignedOffset - nodes[found].offset;
+  if (padding > 0) {
+    // neighbours of a free range are never free, so the padding becomes a range of its own
+    Node range{nodes[found].offset, padding, 0, nodes[found].prevPhysical, found, NONE, NONE, true};
+    uint32_t before = createNode(range);
+    if (nodes[before].prevPhysical != NONE) {
+      nodes[nodes[before].prevPhysical].nextPhysical = before;
+    }
+    nodes[found].prevPhysical = before;
+    nodes[found].offset = alignedOffset;
+    nodes[found].size -= padding;
+    insertFree(before);
+  }
+
+  VkDeviceSize remainder = nodes[found].size - allocSize;
+  if (remainder > 0) {
+    VkDeviceSize end = alignedOffset + allocSize;
+    Node range{end, remainder, 0, found, nodes[found].nextPhysical, NONE, NONE, true};
+    uint32_t after = createNode(range);
+    if (nodes[after].nextPhysical != NONE) {
+      nodes[nodes[after].nextPhysical].prevPhysical = after;
+    }
+    nodes[found].nextPhysical = after;
+    nodes[found].size = allocSize;
+    insertFree(after);
+  }
+
+  nodes[found].free = false;
+  nodes[found].wasted = wasted;
+  allocationCount++;
+  usedBytes += allocSize;
+  wastedBytes += wasted;
+
+  offset = alignedOffset;
+  node = found;
+  return true;
+}
+
+void LveMemoryAllocator::Block::free(uint32_t node) {
+  assert(!nodes[node].free && "Memory freed twice");
+  allocationCount--;
+  usedBytes -= nodes[node].size;
+  wastedBytes -= nodes[node].wasted;
+  nodes[node].free = true;
+
+  uint32_t prev = nodes[node].prevPhysical;
+  if (prev != NONE && nodes[prev].free) {
+    removeFree(prev);
+    nodes[prev].size += nodes[node].size;
+    nodes[prev].nextPhysical = nodes[node].nextPhysical;
+    if (nodes[node].nextPhysical != NONE) {
+      nodes[nodes[node].nextPhysical].prevPhysical = prev;
+    }
+    releaseNode(node);
+    node = prev;
+  }
+
+  uint32_t next = nodes[node].nextPhysical;
+  if (next != NONE && nodes[next].free) {
+    removeFree(next);
+    nodes[node].size += nodes[next].size;
+    nodes[node].nextPhysical = nodes[next].nextPhysical;
+    if (nodes[next].nextPhysical != NONE) {
+      nodes[nodes[next].nextPhysical].prevPhysical = node;
+    }
+    releaseNode(next);
+  }
+
+  insertFree(node);
+}
+
+VkDeviceSize LveMemoryAllocator::Block::largestFreeRange() const {
+  if (flBitmap == 0) {
+    return 0;
+  }
+  uint32_t fl = floorLog2(flBitmap);
+  uint32_t sl = floorLog2(slBitmaps[fl]);
+  VkDeviceSize largest = 0;
+  for (uint32_t node = freeLists[fl][sl]; node != NONE; node = nodes[node].nextFree) {
+    largest = std::max(largest, nodes[node].size);
+  }
+  return largest;
+}
+
+uint32_t LveMemoryAllocator::Block::findFree(VkDeviceSize minSize) const {
+  // round up to the next size class so every range in the list is large enough
+  if (minSize >= SL_COUNT) {
+    minSize += (VkDeviceSize{1} << (floorLog2(minSize) - SL_BITS)) - 1;
+  }
+  uint32_t fl, sl;
+  mapping(minSize, fl, sl);
+  if (fl >= FL_COUNT) {
+    return NONE;
+  }
+
+  uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+  if (slMap == 0) {
+    uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+    if (flMap == 0) {
+      return NONE;
+    }
+    fl = lowestBit(flMap);
+    slMap = slBitmaps[fl];
+  }
+  sl = lowestBit(slMap);
+  return freeLists[fl][sl];
+}
+
+void LveMemoryAllocator::Block::insertFree(uint32_t node) {
+  uint32_t fl, sl;
+  mapping(nodes[node].size, fl, sl);
+  uint32_t head = (slBitmaps[fl] & (1u << sl)) ? freeLists[fl][sl] : NONE;
+
+  nodes[node].prevFree = NONE;
+  nodes[node].nextFree = head;
+  if (head != NONE) {
+    nodes[head].prevFree = node;
+  }
+  freeLists[fl][sl] = node;
+  slBitmaps[fl] |= 1u << sl;
+  flBitmap |= 1ull << fl;
+}
+
+void LveMemoryAllocator::Block::removeFree(uint32_t node) {
+  uint32_t prev = nodes[node].prevFree;
+  uint32_t next = nodes[node].nextFree;
+  if (next != NONE) {
+    nodes[next].prevFree = prev;
+  }
+  if (prev != NONE) {
+    nodes[prev].nextFree = next;
+    return;
+  }
+
+  uint32_t fl, sl;
+  mapping(nodes[node].size, fl, sl);
+  freeLists[fl][sl] = next;
+  if (next == NONE) {
+    slBitmaps[fl] &= ~(1u << sl);
+    if (slBitmaps[fl] == 0) {
+      flBitmap &= ~(1ull << fl);
+    }
+  }
+}
+
+uint32_t LveMemoryAllocator::Block::createNode(const Node &node) {
+  if (!unusedNodes.empty()) {
+    uint32_t index = unusedNodes.back();
+    unusedNodes.pop_back();
+    nodes[index] = node;
+    return index;
+  }
+  nodes.push_back(node);
+  return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void LveMemoryAllocator::Block::releaseNode(uint32_t node) { unusedNodes.push_back(node); }
+
+LveMemoryAllocator::LveMemoryAllocator(
+    VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+    : device{device} {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+  pools.resize(memoryProperties.memoryTypeCount * 2);
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    // small heaps such as the 256 MiB BAR window would be used up by a few blocks
+    uint32_t heapIndex = memoryProperties.memoryTypes[i].heapIndex;
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+    VkDeviceSize poolBlockSize = std::min(blockSize, std::max<VkDeviceSize>(heapSize / 8, 1 << 20));
+    pools[i * 2].blockSize = poolBlockSize;
+    pools[i * 2 + 1].blockSize = poolBlockSize;
+  }
+}
+
+LveMemoryAllocator::~LveMemoryAllocator() {
+  for (auto &pool : pools) {
+    for (auto &block : pool.blocks) {
+      assert(block->empty() && "Memory allocations outlived the allocator");
+      vkFreeMemory(device, block->memory, nullptr);
+    }
+  }
+}
+
+LveMemoryAllocator::Allocation LveMemoryAllocator::allocate(
+    const VkMemoryRequirements &requirements,
+    VkMemoryPropertyFlags properties,
+    bool linear,
+    MemoryCategory category) {
+  uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+  VkDeviceSize size = requirements.size;
+  VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+  if (isHostVisible(memoryTypeIndex)) {
+    size = alignUp(size, nonCoherentAtomSize);
+    alignment = std::max(alignment, nonCoherentAtomSize);
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+  Pool &pool = pools[memoryTypeIndex * 2 + (linear ? 0 : 1)];
+  if (size >= pool.blockSize / 2) {
+    Allocation allocation = allocateDedicated(size, memoryTypeIndex);
+    allocation.category = category;
+    categoryBytes[category] += size;
+    return allocation;
+  }
+
+  Allocation allocation{};
+  allocation.memoryTypeIndex = memoryTypeIndex;
+  allocation.category = category;
+  allocation.size = size;
+  VkDeviceSize wasted = size - requirements.size;
+
+  Block *block = nullptr;
+  for (auto &candidate : pool.blocks) {
+    if (candidate.get() == evacuatingBlock) continue;
+    if (candidate->allocate(size, alignment, wasted, allocation.offset, allocation.node)) {
+      block = candidate.get();
+      break;
+    }
+  }
+  if (block == nullptr) {
+    void *mapped = nullptr;
+    VkDeviceMemory memory = allocateMemory(pool.blockSize, memoryTypeIndex, &mapped);
+    pool.blocks.push_back(std::make_unique<Block>(memory, pool.blockSize, mapped));
+    block = pool.blocks.back().get();
+    block->allocate(size, alignment, wasted, allocation.offset, allocation.node);
+  }
+
+  categoryBytes[category] += size;
+  allocation.block = block;
+  allocation.memory = block->memory;
+  if (block->mapped != nullptr) {
+    allocation.mapped = static_cast<char *>(block->mapped) + allocation.offset;
+  }
+  return allocation;
+}
+
+void LveMemoryAllocator::free(Allocation &allocation) {
+  if (allocation.memory == VK_NULL_HANDLE) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+  categoryBytes[allocation.category] -= allocation.size;
+  if (allocation.block == nullptr) {
+    freeMemory(allocation.memory, allocation.size, allocation.memoryTypeIndex);
+    dedicatedAllocationCount--;
+    dedicatedBytes -= allocation.size;
+    allocation = Allocation{};
+    return;
+  }
+
+  Block *block = allocation.block;
+  block->free(allocation.node);
+  allocation = Allocation{};
+  if (!block->empty()) {
+    return;
+  }
+
+  // keep one empty block per pool so a resource created and destroyed every frame does not
+  // allocate device memory every frame
+  for (size_t i = 0; i < pools.size(); i++) {
+    Pool &pool = pools[i];
+    auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](auto &candidate) {
+      return candidate.get() == block;
+    });
+    if (it == pool.blocks.end()) continue;
+
+    bool hasOtherEmptyBlock =
+        std::any_of(pool.blocks.begin(), pool.blocks.end(), [block](auto &candidate) {
+          return candidate.get() != block && candidate->empty();
+        });
+    // a block that was evacuated to compact memory is always released
+    bool evacuated = block == evacuatingBlock;
+    if (evacuated) {
+      evacuatingBlock = nullptr;
+    }
+    if (hasOtherEmptyBlock || evacuated) {
+      freeMemory(block->memory, block->size, static_cast<uint32_t>(i / 2));
+      pool.blocks.erase(it);
+    }
+    return;
+  }
+}
+
+uint32_t LveMemoryAllocator::findMemoryType(
+    uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+  constexpr VkMemoryPropertyFlags BAR_PROPERTIES =
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+  // host visible memory that did not ask to be device local, such as staging and readback memory,
+  // stays out of host visible VRAM, which may only be a small window
+  VkMemoryPropertyFlags avoided = 0;
+  if ((properties & BAR_PROPERTIES) == VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  }
+
+  uint32_t fallback = UINT32_MAX;
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+    if ((typeFilter & (1 << i)) && (flags & properties) == properties) {
+      if ((flags & avoided) == 0) {
+        return i;
+      }
+      if (fallback == UINT32_MAX) {
+        fallback = i;
+      }
+    }
+  }
+  if (fallback != UINT32_MAX) {
+    return fallback;
+  }
+
+  // without host visible VRAM (resizable BAR) the device reads host memory over the bus instead
+  if ((properties & BAR_PROPERTIES) == BAR_PROPERTIES) {
+    return findMemoryType(typeFilter, properties & ~VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+LveMemoryAllocator::Stats LveMemoryAllocator::getStats() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  Stats stats{};
+  stats.dedicatedAllocationCount = dedicatedAllocationCount;
+  stats.dedicatedBytes = dedicatedBytes;
+  stats.categoryBytes = categoryBytes;
+  stats.heapBytes = heapBytes;
+
+  VkDeviceSize freeBytes = 0;
+  for (auto &pool : pools) {
+    for (auto &block : pool.blocks) {
+      stats.blockCount++;
+      stats.allocationCount += block->allocationCount;
+      stats.blockBytes += block->size;
+      stats.usedBytes += block->usedBytes;
+      stats.wastedBytes += block->wastedBytes;
+      stats.largestFreeRange = std::max(stats.largestFreeRange, block->largestFreeRange());
+      freeBytes += block->size - block->usedBytes;
+    }
+  }
+  if (freeBytes > 0) {
+    stats.fragmentation = 1.f - static_cast<float>(stats.largestFreeRange) / freeBytes;
+  }
+  return stats;
+}
+
+bool LveMemoryAllocator::getBlockUsage(const Block *block, BlockUsage &usage) const {
+  std::lock_guard<std::mutex> lock{mutex};
+  for (auto &pool : pools) {
+    auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](auto &candidate) {
+      return candidate.get() == block;
+    });
+    if (it == pool.blocks.end()) continue;
+
+    usage = BlockUsage{};
+    usage.size = block->size;
+    usage.usedBytes = block->usedBytes;
+    usage.allocationCount = block->allocationCount;
+    for (auto &other : pool.blocks) {
+      if (other.get() != block) {
+        usage.otherFreeBytes += other->size - other->usedBytes;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+void LveMemoryAllocator::setEvacuatingBlock(const Block *block) {
+  std::lock_guard<std::mutex> lock{mutex};
+  evacuatingBlock = block;
+}
+
+bool LveMemoryAllocator::isEvacuating() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  return evacuatingBlock != nullptr;
+}
+
+LveMemoryAllocator::Allocation LveMemoryAllocator::allocateDedicated(
+    VkDeviceSize size, uint32_t memoryTypeIndex) {
+  Allocation allocation{};
+  allocation.memory = allocateMemory(size, memoryTypeIndex, &allocation.mapped);
+  allocation.size = size;
+  allocation.memoryTypeIndex = memoryTypeIndex;
+  dedicatedAllocationCount++;
+  dedicatedBytes += size;
+  return allocation;
+}
+
+VkDeviceMemory LveMemoryAllocator::allocateMemory(
+    VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped) {
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate device memory!");
+  }
+  heapBytes[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex] += size;
+
+  *mapped = nullptr;
+  if (isHostVisible(memoryTypeIndex) &&
+      vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+    freeMemory(memory, size, memoryTypeIndex);
+    throw std::runtime_error("failed to map device memory!");
+  }
+  return memory;
+}
+
+void LveMemoryAllocator::freeMemory(
+    VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex) {
+  vkFreeMemory(device, memory, nullptr);
+  heapBytes[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex] -= size;
+}
+
+const char *LveMemoryAllocator::categoryName(MemoryCategory category) {
+  switch (category) {
+    case MEMORY_CATEGORY_GEOMETRY:
+      return "geometry";
+    case MEMORY_CATEGORY_UNIFORMS:
+      return "uniforms";
+    case MEMORY_CATEGORY_STAGING:
+      return "staging";
+    case MEMORY_CATEGORY_ATTACHMENTS:
+      return "attachments";
+    default:
+      return "other";
+  }
+}
+
+bool LveMemoryAllocator::isHostVisible(uint32_t memoryTypeIndex) const {
+  return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags &
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+}  // namespace lve
@@ -0,0 +1,130 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lve {
+
+// Sub-allocates buffer and image memory from large per memory type blocks, so resources do not
+// each cost a vkAllocateMemory call or count against maxMemoryAllocationCount. Placement inside a
+// block uses a TLSF (two level segregated fit) allocator, which finds a free range and merges
+// freed ranges with their neighbours in constant time. Resources of at least half a block get a
+// dedicated allocation.
+//
+// Host visible blocks stay mapped for their whole lifetime, and host visible allocations are
+// padded to nonCoherentAtomSize so each one can be flushed on its own.
+class LveMemoryAllocator {
+ public:
+  static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+  class Block;
+
+  // what an allocation is used for, to report memory use by category
+  enum MemoryCategory {
+    MEMORY_CATEGORY_GEOMETRY,
+    MEMORY_CATEGORY_UNIFORMS,
+    MEMORY_CATEGORY_STAGING,
+    MEMORY_CATEGORY_ATTACHMENTS,
+    MEMORY_CATEGORY_OTHER,
+    MEMORY_CATEGORY_COUNT
+  };
+
+  struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;  // host address of offset, null unless the memory is host visible
+    uint32_t memoryTypeIndex = 0;
+    MemoryCategory category = MEMORY_CATEGORY_OTHER;
+
+    Block *block = nullptr;  // null for dedicated allocations
+    uint32_t node = 0;
+  };
+
+  struct Stats {
+    uint32_t blockCount = 0;
+    uint32_t dedicatedAllocationCount = 0;
+    uint32_t allocationCount = 0;  // sub-allocations within blocks
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize usedBytes = 0;       // by sub-allocations, including their padding
+    VkDeviceSize wastedBytes = 0;     // padding of sub-allocations beyond the requested size
+    VkDeviceSize dedicatedBytes = 0;
+    VkDeviceSize largestFreeRange = 0;
+    // 1 - largest free range / free bytes, 0 when all free space within blocks is contiguous
+    float fragmentation = 0.f;
+    // size of the allocations of each category, including their padding
+    std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT> categoryBytes{};
+    // device memory allocated from each heap, blocks and dedicated allocations
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapBytes{};
+  };
+
+  LveMemoryAllocator(
+      VkPhysicalDevice physicalDevice,
+      VkDevice device,
+      VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+  ~LveMemoryAllocator();
+
+  LveMemoryAllocator(const LveMemoryAllocator &) = delete;
+  LveMemoryAllocator &operator=(const LveMemoryAllocator &) = delete;
+
+  // linear is true for buffers and linear images, they are kept in separate blocks from optimal
+  // images so bufferImageGranularity never applies
+  Allocation allocate(
+      const VkMemoryRequirements &requirements,
+      VkMemoryPropertyFlags properties,
+      bool linear,
+      MemoryCategory category = MEMORY_CATEGORY_OTHER);
+  void free(Allocation &allocation);
+
+  // Host visible requests without DEVICE_LOCAL prefer system memory. Requests for both fall back
+  // to host visible system memory if the device has no host visible VRAM.
+  uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+  const VkPhysicalDeviceMemoryProperties &getMemoryProperties() const { return memoryProperties; }
+  Stats getStats() const;
+  static const char *categoryName(MemoryCategory category);
+
+  // Defragmentation support, see LveDefragmenter
+  struct BlockUsage {
+    VkDeviceSize size = 0;
+    VkDeviceSize usedBytes = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize otherFreeBytes = 0;  // in the other blocks of the same pool
+  };
+  // Returns false if block was released
+  bool getBlockUsage(const Block *block, BlockUsage &usage) const;
+  // New allocations avoid block, which is released as soon as it is empty. nullptr cancels.
+  void setEvacuatingBlock(const Block *block);
+  bool isEvacuating() const;
+
+ private:
+  struct Pool {
+    VkDeviceSize blockSize = 0;
+    std::vector<std::unique_ptr<Block>> blocks;
+  };
+
+  Allocation allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex);
+  VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped);
+  void freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex);
+  bool isHostVisible(uint32_t memoryTypeIndex) const;
+
+  VkDevice device;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  VkDeviceSize nonCoherentAtomSize;
+
+  mutable std::mutex mutex;
+  std::vector<Pool> pools;  // two per memory type, linear then optimal
+  uint32_t dedicatedAllocationCount = 0;
+  VkDeviceSize dedicatedBytes = 0;
+  std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT> categoryBytes{};
+  std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapBytes{};
+  const Block *evacuatingBlock = nullptr;
+};
+
+}  // namespace lve
@@ -0,0 +1,216 @@
+#include "lve_mesh_cache.hpp"
+
+#include "lve_utils.hpp"
+
+// std
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace lve {
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// written so that corrupt offsets near the top of the range cannot wrap around
+static bool fitsInFile(uint64_t offset, uint64_t bytes, uint64_t fileSize) {
+  return offset <= fileSize && bytes <= fileSize - offset;
+}
+
+static int64_t modifiedTime(const std::string &filepath) {
+  std::error_code error;
+  auto time = std::filesystem::last_write_time(filepath, error);
+  if (error) {
+    return 0;
+  }
+  return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+uint64_t LveMeshCache::lodOffset(const Header &header) {
+  uint64_t indexBytes = uint64_t{header.indexCount} * sizeof(uint32_t);
+  return alignOffset(header.indexOffset + indexBytes, BLOB_ALIGNMENT);
+}
+
+uint64_t LveMeshCache::meshletOffset(const Header &header) {
+  uint64_t lodBytes = uint64_t{header.lodCount} * sizeof(LveModel::Lod);
+  return alignOffset(lodOffset(header) + lodBytes, BLOB_ALIGNMENT);
+}
+
+std::string LveMeshCache::cachePathFor(const std::string &sourcePath) {
+  return sourcePath + ".lvemesh";
+}
+
+uint64_t LveMeshCache::hashFile(const std::string &filepath) {
+  LveMappedFile source{filepath};
+  return hashBytes(source.data(), source.size());
+}
+
+bool LveMeshCache::isSourceUnchanged(const Header &header, const std::string &sourcePath) {
+  std::error_code error;
+  if (!std::filesystem::exists(sourcePath, error)) {
+    // cooked cache shipped without its source, nothing to compare against
+    return true;
+  }
+
+  if (std::filesystem::file_size(sourcePath, error) != header.sourceSize || error) {
+    return false;
+  }
+  if (modifiedTime(sourcePath) == header.sourceModifiedTime) {
+    return true;
+  }
+
+  // timestamps change on checkout or copy, fall back to comparing the content
+  return hashFile(sourcePath) == header.sourceHash;
+}
+
+bool LveMeshCache::open(
+    const std::string &cachePath, const std::string &sourcePath, uint32_t flags) {
+  std::error_code error;
+  if (!std::filesystem::exists(cachePath, error)) {
+    return false;
+  }
+
+  // a cache that cannot be mapped, such as one locked by another process, is rebuilt
+  std::unique_ptr<LveMappedFile> mappedFile;
+  try {
+    mappedFile = std::make_unique<LveMappedFile>(cachePath);
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+  if (mappedFile->size() < sizeof(Header)) {
+    return false;
+  }
+
+  Header fileHeader{};
+  std::memcpy(&fileHeader, mappedFile->data(), sizeof(Header));
+  if (fileHeader.magic != MAGIC || fileHeader.version != VERSION ||
+      fileHeader.vertexSize != sizeof(LveModel::Vertex) || fileHeader.flags != flags) {
+    return false;
+  }
+
+  uint64_t vertexBytes = uint64_t{fileHeader.vertexCount} * sizeof(LveModel::Vertex);
+  uint64_t indexBytes = uint64_t{fileHeader.indexCount} * sizeof(uint32_t);
+  uint64_t lodBytes = uint64_t{fileHeader.lodCount} * sizeof(LveModel::Lod);
+  uint64_t meshletBytes = uint64_t{fileHeader.meshletCount} * sizeof(LveModel::Meshlet);
+  // checked in order, the LOD and meshlet offsets are computed from the end of the previous block
+  uint64_t fileSize = mappedFile->size();
+  if (!fitsInFile(fileHeader.vertexOffset, vertexBytes, fileSize) ||
+      !fitsInFile(fileHeader.indexOffset, indexBytes, fileSize) ||
+      !fitsInFile(lodOffset(fileHeader), lodBytes, fileSize) ||
+      !fitsInFile(meshletOffset(fileHeader), meshletBytes, fileSize)) {
+    return false;
+  }
+
+  if (!isSourceUnchanged(fileHeader, sourcePath)) {
+    return false;
+  }
+
+  file = std::move(mappedFile);
+  header = fileHeader;
+  return true;
+}
+
+void LveMeshCache::write(
+    const std::string &cachePath,
+    const std::string &sourcePath,
+    const LveModel::Builder &builder,
+    uint32_t flags) {
+  Header fileHeader{};
+  fileHeader.magic = MAGIC;
+  fileHeader.version = VERSION;
+  fileHeader.vertexSize = sizeof(LveModel::Vertex);
+  fileHeader.flags = flags;
+  fileHeader.sourceSize = static_cast<uint64_t>(std::filesystem::file_size(sourcePath));
+  fileHeader.sourceModifiedTime = modifiedTime(sourcePath);
+  fileHeader.sourceHash = hashFile(sourcePath);
+  fileHeader.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+  fileHeader.indexCount = static_cast<uint32_t>(builder.indices.size());
+  fileHeader.lodCount = static_cast<uint32_t>(builder.lods.size());
+  fileHeader.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+
+  uint64_t vertexBytes = uint64_t{fileHeader.vertexCount} * sizeof(LveModel::Vertex);
+  uint64_t indexBytes = uint64_t{fileHeader.indexCount} * sizeof(uint32_t);
+  uint64_t lodBytes = uint64_t{fileHeader.lodCount} * sizeof(LveModel::Lod);
+  uint64_t meshletBytes = uint64_t{fileHeader.meshletCount} * sizeof(LveModel::Meshlet);
+  fileHeader.vertexOffset = alignOffset(sizeof(Header), BLOB_ALIGNMENT);
+  fileHeader.indexOffset = alignOffset(fileHeader.vertexOffset + vertexBytes, BLOB_ALIGNMENT);
+
+  auto bounds = builder.computeBounds();
+  for (int i = 0; i < 3; i++) {
+    fileHeader.boundsMin[i] = bounds.min[i];
+    fileHeader.boundsMax[i] = bounds.max[i];
+  }
+
+  // write to a temporary file first so an interrupted write never leaves a truncated cache behind,
+  // named uniquely as loader threads, or several running processes, may write the same cache file
+  // at the same time
+  static const uint32_t processTag = std::random_device{}();
+  static std::atomic<uint64_t> tempFileCount{0};
+  std::string tempPath = cachePath + "." + std::to_string(processTag) + "." +
+                         std::to_string(tempFileCount++) + ".tmp";
+  {
+    std::ofstream out{tempPath, std::ios::binary | std::ios::trunc};
+    if (!out.is_open()) {
+      std::cerr << "failed to write mesh cache: " << cachePath << std::endl;
+      return;
+    }
+
+    const char padding[BLOB_ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char *>(&fileHeader), sizeof(Header));
+    out.write(padding, fileHeader.vertexOffset - sizeof(Header));
+    out.write(reinterpret_cast<const char *>(builder.vertices.data()), vertexBytes);
+    out.write(padding, fileHeader.indexOffset - (fileHeader.vertexOffset + vertexBytes));
+    out.write(reinterpret_cast<const char *>(builder.indices.data()), indexBytes);
+    out.write(padding, lodOffset(fileHeader) - (fileHeader.indexOffset + indexBytes));
+    out.write(reinterpret_cast<const char *>(builder.lods.data()), lodBytes);
+    out.write(padding, meshletOffset(fileHeader) - (lodOffset(fileHeader) + lodBytes));
+    out.write(reinterpret_cast<const char *>(builder.meshlets.data()), meshletBytes);
+
+    if (!out.good()) {
+      std::cerr << "failed to write mesh cache: " << cachePath << std::endl;
+      out.close();
+      std::error_code error;
+      std::filesystem::remove(tempPath, error);
+      return;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, cachePath, error);
+  if (error) {
+    std::cerr << "failed to write mesh cache: " << cachePath << std::endl;
+    std::filesystem::remove(tempPath, error);
+  }
+}
+
+const LveModel::Vertex *LveMeshCache::vertices() const {
+  return reinterpret_cast<const LveModel::Vertex *>(file->data() + header.vertexOffset);
+}
+
+const uint32_t *LveMeshCache::indices() const {
+  return reinterpret_cast<const uint32_t *>(file->data() + header.indexOffset);
+}
+
+const LveModel::Lod *LveMeshCache::lods() const {
+  return reinterpret_cast<const LveModel::Lod *>(file->data() + lodOffset(header));
+}
+
+const LveModel::Meshlet *LveMeshCache::meshlets() const {
+  return reinterpret_cast<const LveModel::Meshlet *>(file->data() + meshletOffset(header));
+}
+
+LveModel::BoundingBox LveMeshCache::bounds() const {
+  LveModel::BoundingBox box{};
+  for (int i = 0; i < 3; i++) {
+    box.min[i] = header.boundsMin[i];
+    box.max[i] = header.boundsMax[i];
+  }
+  return box;
+}
+
+}  // namespace lve
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "lve_mapped_file.hpp"
+#include "lve_model.hpp"
+
+// std
+#include <memory>
+#include <string>
+
+namespace lve {
+
+// Binary .lvemesh cache of a processed model. The file is laid out as a fixed size header
+// followed by the raw vertex, index, LOD and meshlet blobs, so a warm load only needs to map the
+// file and copy the blobs into staging memory.
+class LveMeshCache {
+ public:
+  static constexpr uint32_t MAGIC = 0x48534d4c;  // "LMSH"
+  static constexpr uint32_t VERSION = 3;
+  static constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;  // guards against changes to the LveModel::Vertex layout
+    uint32_t flags;  // LveModel::OptimizeFlagBits the model was processed with
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    uint64_t sourceHash;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t lodCount;      // LveModel::Lod table stored after the indices, 0 for a single LOD
+    uint32_t meshletCount;  // LveModel::Meshlet table stored after the LOD table
+  };
+  static_assert(sizeof(Header) == 96, "lvemesh header layout must not change without VERSION");
+
+  LveMeshCache() = default;
+
+  LveMeshCache(const LveMeshCache &) = delete;
+  LveMeshCache &operator=(const LveMeshCache &) = delete;
+
+  static std::string cachePathFor(const std::string &sourcePath);
+
+  // Maps the cache file, returns false if it is missing, malformed, stale relative to the source or
+  // was processed with different LveModel::OptimizeFlagBits
+  bool open(const std::string &cachePath, const std::string &sourcePath, uint32_t flags);
+  static void write(
+      const std::string &cachePath,
+      const std::string &sourcePath,
+      const LveModel::Builder &builder,
+      uint32_t flags);
+
+  const LveModel::Vertex *vertices() const;
+  const uint32_t *indices() const;
+  uint32_t vertexCount() const { return header.vertexCount; }
+  uint32_t indexCount() const { return header.indexCount; }
+  const LveModel::Lod *lods() const;
+  uint32_t lodCount() const { return header.lodCount; }
+  const LveModel::Meshlet *meshlets() const;
+  uint32_t meshletCount() const { return header.meshletCount; }
+  LveModel::BoundingBox bounds() const;
+
+ private:
+  static bool isSourceUnchanged(const Header &header, const std::string &sourcePath);
+  static uint64_t hashFile(const std::string &filepath);
+  static uint64_t lodOffset(const Header &header);
+  static uint64_t meshletOffset(const Header &header);
+
+  std::unique_ptr<LveMappedFile> file;
+  Header header{};
+};
+
+}  // namespace lve
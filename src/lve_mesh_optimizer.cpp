@@ -0,0 +1,667 @@
+#include "lve_mesh_optimizer.hpp"
+
+#include "lve_weld_table.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace lve {
+
+namespace {
+
+constexpr uint32_t UNUSED = UINT32_MAX;
+
+// Triangles adjacent to each vertex, stored as one flat array with per vertex offsets
+struct TriangleAdjacency {
+  std::vector<uint32_t> counts;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+
+  TriangleAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount)
+      : counts(vertexCount, 0), offsets(vertexCount, 0), triangles(indices.size()) {
+    for (uint32_t index : indices) {
+      counts[index]++;
+    }
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+      offsets[i] = offset;
+      offset += counts[i];
+    }
+
+    std::vector<uint32_t> fill = offsets;
+    for (size_t i = 0; i < indices.size(); i++) {
+      triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+};
+
+// FIFO post-transform cache simulation, a vertex is cached if it missed within the last cacheSize
+// misses
+class FifoCache {
+ public:
+  FifoCache(size_t vertexCount, uint32_t cacheSize)
+      : cacheSize{cacheSize}, timestamps(vertexCount, 0) {}
+
+  // returns true on a cache miss
+  bool access(uint32_t vertex) {
+    if (timestamps[vertex] == 0 || time - timestamps[vertex] >= cacheSize) {
+      timestamps[vertex] = ++time;
+      return true;
+    }
+    return false;
+  }
+
+  void flush() { time += cacheSize; }
+
+ private:
+  uint32_t cacheSize;
+  uint32_t time = 0;
+  std::vector<uint32_t> timestamps;
+};
+
+// Sum of squared distances to a set of planes, stored as the upper triangle of a symmetric 4x4
+struct Quadric {
+  double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+  double b0 = 0, b1 = 0, b2 = 0;
+  double c = 0;
+
+  void addPlane(const glm::vec3 &normal, float distance) {
+    double x = normal.x, y = normal.y, z = normal.z, d = distance;
+    a00 += x * x;
+    a01 += x * y;
+    a02 += x * z;
+    a11 += y * y;
+    a12 += y * z;
+    a22 += z * z;
+    b0 += x * d;
+    b1 += y * d;
+    b2 += z * d;
+    c += d * d;
+  }
+
+  Quadric &operator+=(const Quadric &other) {
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+    return *this;
+  }
+
+  double error(const glm::vec3 &p) const {
+    double x = p.x, y = p.y, z = p.z;
+    double result = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + a11 * y * y +
+                    2 * a12 * y * z + a22 * z * z + 2 * (b0 * x + b1 * y + b2 * z) + c;
+    return std::max(result, 0.0);
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+}  // namespace
+
+LveMeshOptimizer::Report LveMeshOptimizer::optimize(LveModel::Builder &builder, uint32_t flags) {
+  Report report{};
+  if (builder.indices.empty()) {
+    return report;
+  }
+
+  // any existing LOD chain is regenerated from the full detail indices
+  if (!builder.lods.empty()) {
+    builder.indices.resize(builder.lods[0].indexCount);
+    builder.lods.clear();
+  }
+  builder.meshlets.clear();
+
+  report.before = analyzeVertexCache(builder.indices, builder.vertices.size());
+
+  if (flags & LveModel::OPTIMIZE_VERTEX_CACHE) {
+    optimizeVertexCache(builder.indices, builder.vertices.size());
+  }
+  if (flags & LveModel::OPTIMIZE_OVERDRAW) {
+    optimizeOverdraw(builder.indices, builder.vertices);
+  }
+
+  report.after = analyzeVertexCache(builder.indices, builder.vertices.size());
+
+  if (flags & LveModel::OPTIMIZE_GENERATE_LODS) {
+    generateLods(builder, flags & LveModel::OPTIMIZE_VERTEX_CACHE);
+  }
+  if (flags & LveModel::OPTIMIZE_VERTEX_FETCH) {
+    // LOD 0 comes first in the index buffer, so it gets the best fetch locality
+    optimizeVertexFetch(builder.indices, builder.vertices);
+  }
+  if (flags & LveModel::OPTIMIZE_BUILD_MESHLETS) {
+    buildMeshlets(builder);
+  }
+
+  return report;
+}
+
+void LveMeshOptimizer::buildMeshlets(LveModel::Builder &builder) {
+  builder.meshlets.clear();
+  uint32_t indexCount = builder.lods.empty() ? static_cast<uint32_t>(builder.indices.size())
+                                             : builder.lods[0].indexCount;
+
+  // meshlet each vertex was last added to, avoids clearing a set per meshlet
+  std::vector<uint32_t> vertexMeshlet(builder.vertices.size(), UNUSED);
+  std::vector<uint32_t> meshletVertices{};
+
+  auto finishMeshlet = [&](uint32_t firstIndex, uint32_t endIndex) {
+    LveModel::Meshlet meshlet{};
+    meshlet.firstIndex = firstIndex;
+    meshlet.indexCount = endIndex - firstIndex;
+
+    glm::vec3 min = builder.vertices[meshletVertices[0]].position;
+    glm::vec3 max = min;
+    for (uint32_t vertex : meshletVertices) {
+      min = glm::min(min, builder.vertices[vertex].position);
+      max = glm::max(max, builder.vertices[vertex].position);
+    }
+    meshlet.center = (min + max) * 0.5f;
+    for (uint32_t vertex : meshletVertices) {
+      meshlet.radius = std::max(
+          meshlet.radius,
+          glm::length(builder.vertices[vertex].position - meshlet.center));
+    }
+
+    std::vector<glm::vec3> normals{};
+    glm::vec3 axis{0.f};
+    for (uint32_t i = firstIndex; i < endIndex; i += 3) {
+      const glm::vec3 &p0 = builder.vertices[builder.indices[i + 0]].position;
+      const glm::vec3 &p1 = builder.vertices[builder.indices[i + 1]].position;
+      const glm::vec3 &p2 = builder.vertices[builder.indices[i + 2]].position;
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float length = glm::length(normal);
+      if (length == 0.f) continue;
+      normals.push_back(normal / length);
+      axis += normals.back();
+    }
+
+    // cones wider than about 84 degrees reject almost nothing, mark them unusable
+    meshlet.coneCutoff = 1.f;
+    float axisLength = glm::length(axis);
+    if (axisLength > 0.f) {
+      meshlet.coneAxis = axis / axisLength;
+      float minDot = 1.f;
+      for (const auto &normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+      }
+      if (minDot > 0.1f) {
+        meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+      }
+    }
+
+    builder.meshlets.push_back(meshlet);
+    meshletVertices.clear();
+  };
+
+  uint32_t meshletStart = 0;
+  for (uint32_t i = 0; i < indexCount; i += 3) {
+    uint32_t meshletId = static_cast<uint32_t>(builder.meshlets.size());
+    uint32_t newVertices = 0;
+    for (uint32_t k = 0; k < 3; k++) {
+      uint32_t vertex = builder.indices[i + k];
+      bool repeated = (k > 0 && builder.indices[i] == vertex) ||
+                      (k > 1 && builder.indices[i + 1] == vertex);
+      if (vertexMeshlet[vertex] != meshletId && !repeated) newVertices++;
+    }
+
+    uint32_t triangleCount = (i - meshletStart) / 3;
+    if (triangleCount == LveModel::MAX_MESHLET_TRIANGLES ||
+        meshletVertices.size() + newVertices > LveModel::MAX_MESHLET_VERTICES) {
+      finishMeshlet(meshletStart, i);
+      meshletStart = i;
+      meshletId++;
+    }
+
+    for (uint32_t k = 0; k < 3; k++) {
+      uint32_t vertex = builder.indices[i + k];
+      if (vertexMeshlet[vertex] != meshletId) {
+        vertexMeshlet[vertex] = meshletId;
+        meshletVertices.push_back(vertex);
+      }
+    }
+  }
+  if (indexCount > meshletStart) {
+    finishMeshlet(meshletStart, indexCount);
+  }
+}
+
+void LveMeshOptimizer::generateLods(LveModel::Builder &builder, bool optimizeCache) {
+  std::vector<uint32_t> baseIndices = builder.indices;
+  builder.lods.clear();
+  builder.lods.push_back({0, static_cast<uint32_t>(baseIndices.size()), 0.f});
+
+  // each LOD is simplified from the previous one, so the errors add up to a conservative bound
+  // relative to full detail that also never decreases along the chain
+  float error = 0.f;
+  std::vector<uint32_t> previousIndices = std::move(baseIndices);
+  while (builder.lods.size() < MAX_LOD_COUNT) {
+    size_t targetTriangles = static_cast<size_t>(previousIndices.size() / 3 * LOD_RATIO);
+    if (targetTriangles < MIN_LOD_TRIANGLES) {
+      break;
+    }
+
+    float lodError = 0.f;
+    std::vector<uint32_t> lodIndices =
+        simplify(builder.vertices, previousIndices, targetTriangles * 3, &lodError);
+
+    // stop once simplification stalls on locked seams and borders
+    if (lodIndices.empty() || lodIndices.size() > previousIndices.size() * 9 / 10) {
+      break;
+    }
+    if (optimizeCache) {
+      optimizeVertexCache(lodIndices, builder.vertices.size());
+    }
+
+    error += lodError;
+    builder.lods.push_back(
+        {static_cast<uint32_t>(builder.indices.size()),
+         static_cast<uint32_t>(lodIndices.size()),
+         error});
+    builder.indices.insert(builder.indices.end(), lodIndices.begin(), lodIndices.end());
+    previousIndices = std::move(lodIndices);
+  }
+
+  if (builder.lods.size() == 1) {
+    builder.lods.clear();
+  }
+}
+
+std::vector<uint32_t> LveMeshOptimizer::simplify(
+    const std::vector<LveModel::Vertex> &vertices,
+    const std::vector<uint32_t> &sourceIndices,
+    size_t targetIndexCount,
+    float *resultError) {
+  std::vector<uint32_t> indices = sourceIndices;
+  size_t vertexCount = vertices.size();
+  if (resultError) {
+    *resultError = 0.f;
+  }
+
+  // vertices that share a position with different attributes form a seam
+  std::vector<glm::vec3> positions{};
+  std::vector<uint32_t> positionIds(vertexCount);
+  {
+    LveWeldTable<glm::vec3> positionTable{positions, vertexCount};
+    for (size_t i = 0; i < vertexCount; i++) {
+      positionIds[i] = positionTable.weld(vertices[i].position);
+    }
+  }
+
+  std::vector<bool> used(vertexCount, false);
+  for (uint32_t index : indices) {
+    used[index] = true;
+  }
+  std::vector<uint32_t> verticesAtPosition(positions.size(), 0);
+  for (size_t i = 0; i < vertexCount; i++) {
+    if (used[i]) verticesAtPosition[positionIds[i]]++;
+  }
+
+  // edges that do not have exactly two triangles are borders or non-manifold
+  std::unordered_map<uint64_t, uint32_t> edgeTriangles{};
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (size_t k = 0; k < 3; k++) {
+      uint64_t a = positionIds[indices[i + k]];
+      uint64_t b = positionIds[indices[i + (k + 1) % 3]];
+      if (a == b) continue;
+      edgeTriangles[std::min(a, b) << 32 | std::max(a, b)]++;
+    }
+  }
+  std::vector<bool> lockedPositions(positions.size(), false);
+  for (const auto &kv : edgeTriangles) {
+    if (kv.second != 2) {
+      lockedPositions[kv.first >> 32] = true;
+      lockedPositions[kv.first & 0xffffffff] = true;
+    }
+  }
+
+  // seam and border vertices never move, which keeps UV seams and mesh outlines intact
+  std::vector<bool> locked(vertexCount);
+  for (size_t i = 0; i < vertexCount; i++) {
+    locked[i] = verticesAtPosition[positionIds[i]] > 1 || lockedPositions[positionIds[i]];
+  }
+
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const glm::vec3 &p0 = vertices[indices[i + 0]].position;
+    const glm::vec3 &p1 = vertices[indices[i + 1]].position;
+    const glm::vec3 &p2 = vertices[indices[i + 2]].position;
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float length = glm::length(normal);
+    if (length == 0.f) continue;
+    normal /= length;
+
+    Quadric plane{};
+    plane.addPlane(normal, -glm::dot(normal, p0));
+    for (size_t k = 0; k < 3; k++) {
+      quadrics[indices[i + k]] += plane;
+    }
+  }
+
+  auto wouldFlip = [&](const TriangleAdjacency &adjacency, uint32_t from, uint32_t to) {
+    uint32_t begin = adjacency.offsets[from];
+    uint32_t end = begin + adjacency.counts[from];
+    for (uint32_t i = begin; i < end; i++) {
+      const uint32_t *triangle = &indices[adjacency.triangles[i] * 3];
+      if (triangle[0] == to || triangle[1] == to || triangle[2] == to) continue;
+
+      glm::vec3 p[3];
+      for (int k = 0; k < 3; k++) p[k] = vertices[triangle[k]].position;
+      glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+      for (int k = 0; k < 3; k++) {
+        if (triangle[k] == from) p[k] = vertices[to].position;
+      }
+      glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+      if (glm::dot(before, after) <= 0.f) return true;
+    }
+    return false;
+  };
+
+  double maxError = 0.0;
+  std::vector<Collapse> candidates{};
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<bool> touched(vertexCount);
+
+  while (indices.size() > targetIndexCount) {
+    TriangleAdjacency adjacency{indices, vertexCount};
+
+    candidates.clear();
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      for (size_t k = 0; k < 3; k++) {
+        uint32_t a = indices[i + k];
+        uint32_t b = indices[i + (k + 1) % 3];
+        if (!locked[a]) candidates.push_back({a, b, quadrics[a].error(vertices[b].position)});
+        if (!locked[b]) candidates.push_back({b, a, quadrics[b].error(vertices[a].position)});
+      }
+    }
+    if (candidates.empty()) {
+      break;
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Collapse &a, const Collapse &b) {
+      return a.cost < b.cost;
+    });
+
+    // Each collapse removes about two triangles. Collapses well above the cost needed to reach
+    // the target are left for later passes, after the cheaper ones have updated the quadrics.
+    size_t trianglesToRemove = (indices.size() - targetIndexCount) / 3;
+    size_t goalCandidate = std::min(candidates.size() - 1, trianglesToRemove / 2);
+    double passErrorLimit = candidates[goalCandidate].cost * 1.5;
+
+    std::iota(remap.begin(), remap.end(), 0);
+    std::fill(touched.begin(), touched.end(), false);
+    size_t removedTriangles = 0;
+    size_t collapseCount = 0;
+    for (const auto &collapse : candidates) {
+      if (collapse.cost > passErrorLimit || removedTriangles >= trianglesToRemove) break;
+      if (touched[collapse.from] || touched[collapse.to]) continue;
+      if (wouldFlip(adjacency, collapse.from, collapse.to)) continue;
+
+      // lock the one ring so later collapses in this pass see up to date positions
+      uint32_t begin = adjacency.offsets[collapse.from];
+      uint32_t end = begin + adjacency.counts[collapse.from];
+      for (uint32_t i = begin; i < end; i++) {
+        const uint32_t *triangle = &indices[adjacency.triangles[i] * 3];
+        bool removed = false;
+        for (int k = 0; k < 3; k++) {
+          touched[triangle[k]] = true;
+          removed |= triangle[k] == collapse.to;
+        }
+        removedTriangles += removed ? 1 : 0;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      maxError = std::max(maxError, collapse.cost);
+      collapseCount++;
+    }
+    if (collapseCount == 0) {
+      break;
+    }
+
+    size_t writeOffset = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      uint32_t a = remap[indices[i + 0]];
+      uint32_t b = remap[indices[i + 1]];
+      uint32_t c = remap[indices[i + 2]];
+      if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] ||
+          positionIds[a] == positionIds[c]) {
+        continue;
+      }
+      indices[writeOffset++] = a;
+      indices[writeOffset++] = b;
+      indices[writeOffset++] = c;
+    }
+    indices.resize(writeOffset);
+  }
+
+  if (resultError) {
+    *resultError = static_cast<float>(std::sqrt(maxError));
+  }
+  return indices;
+}
+
+void LveMeshOptimizer::optimizeVertexCache(
+    std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+  assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  TriangleAdjacency adjacency{indices, vertexCount};
+  std::vector<uint32_t> liveTriangles = adjacency.counts;
+  std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEndStack{};
+  std::vector<uint32_t> candidates{};
+
+  std::vector<uint32_t> result{};
+  result.reserve(indices.size());
+
+  uint32_t time = cacheSize + 1;
+  size_t cursor = 0;
+  uint32_t fanningVertex = 0;
+  while (fanningVertex < vertexCount && liveTriangles[fanningVertex] == 0) fanningVertex++;
+
+  while (fanningVertex != UNUSED && fanningVertex < vertexCount) {
+    candidates.clear();
+
+    // emit every remaining triangle around the fanning vertex
+    uint32_t begin = adjacency.offsets[fanningVertex];
+    uint32_t end = begin + adjacency.counts[fanningVertex];
+    for (uint32_t i = begin; i < end; i++) {
+      uint32_t triangle = adjacency.triangles[i];
+      if (emitted[triangle]) continue;
+      emitted[triangle] = true;
+
+      for (uint32_t k = 0; k < 3; k++) {
+        uint32_t vertex = indices[triangle * 3 + k];
+        result.push_back(vertex);
+        deadEndStack.push_back(vertex);
+        candidates.push_back(vertex);
+        liveTriangles[vertex]--;
+        if (time - cacheTimestamps[vertex] > cacheSize) {
+          cacheTimestamps[vertex] = time++;
+        }
+      }
+    }
+
+    // prefer the candidate that stays in the cache longest while still having triangles left
+    uint32_t next = UNUSED;
+    int64_t bestPriority = -1;
+    for (uint32_t vertex : candidates) {
+      if (liveTriangles[vertex] == 0) continue;
+      int64_t priority = 0;
+      if (time - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+        priority = time - cacheTimestamps[vertex];
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        next = vertex;
+      }
+    }
+
+    // dead end, fall back to recently used vertices and then to input order
+    while (next == UNUSED && !deadEndStack.empty()) {
+      uint32_t vertex = deadEndStack.back();
+      deadEndStack.pop_back();
+      if (liveTriangles[vertex] > 0) next = vertex;
+    }
+    while (next == UNUSED && cursor < vertexCount) {
+      if (liveTriangles[cursor] > 0) next = static_cast<uint32_t>(cursor);
+      cursor++;
+    }
+
+    fanningVertex = next;
+  }
+
+  indices.swap(result);
+}
+
+void LveMeshOptimizer::optimizeOverdraw(
+    std::vector<uint32_t> &indices,
+    const std::vector<LveModel::Vertex> &vertices,
+    float threshold,
+    uint32_t cacheSize) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  CacheStats stats = analyzeVertexCache(indices, vertices.size(), cacheSize);
+
+  // Split wherever the current cluster, simulated from an empty cache, is already about as cache
+  // efficient as the whole mesh. Clusters can then be drawn in any order for at most threshold
+  // times the optimized miss ratio.
+  std::vector<size_t> clusterStarts{0};
+  FifoCache cache{vertices.size(), cacheSize};
+  uint32_t clusterMisses = 0;
+  for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+    for (size_t k = 0; k < 3; k++) {
+      clusterMisses += cache.access(indices[triangle * 3 + k]) ? 1 : 0;
+    }
+
+    size_t clusterSize = triangle + 1 - clusterStarts.back();
+    if (clusterMisses <= threshold * stats.acmr * clusterSize && triangle + 1 < triangleCount) {
+      clusterStarts.push_back(triangle + 1);
+      clusterMisses = 0;
+      cache.flush();
+    }
+  }
+  clusterStarts.push_back(triangleCount);
+  size_t clusterCount = clusterStarts.size() - 1;
+
+  glm::vec3 meshCentroid{0.f};
+  float meshArea = 0.f;
+  std::vector<float> sortKeys(clusterCount);
+  std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{0.f});
+  std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{0.f});
+  std::vector<float> clusterAreas(clusterCount, 0.f);
+
+  for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+    for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1];
+         triangle++) {
+      const glm::vec3 &p0 = vertices[indices[triangle * 3 + 0]].position;
+      const glm::vec3 &p1 = vertices[indices[triangle * 3 + 1]].position;
+      const glm::vec3 &p2 = vertices[indices[triangle * 3 + 2]].position;
+
+      // cross product length is twice the area, which is all that matters for weighting
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float area = glm::length(normal);
+      glm::vec3 centroid = (p0 + p1 + p2) / 3.f;
+
+      clusterCentroids[cluster] += centroid * area;
+      clusterNormals[cluster] += normal;
+      clusterAreas[cluster] += area;
+      meshCentroid += centroid * area;
+      meshArea += area;
+    }
+  }
+  if (meshArea > 0.f) {
+    meshCentroid /= meshArea;
+  }
+
+  for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+    glm::vec3 centroid = clusterAreas[cluster] > 0.f
+                             ? clusterCentroids[cluster] / clusterAreas[cluster]
+                             : clusterCentroids[cluster];
+    float normalLength = glm::length(clusterNormals[cluster]);
+    glm::vec3 normal = normalLength > 0.f ? clusterNormals[cluster] / normalLength : glm::vec3{0.f};
+    sortKeys[cluster] = glm::dot(centroid - meshCentroid, normal);
+  }
+
+  // clusters facing away from the centre are more likely to occlude the rest, draw them first
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  std::vector<uint32_t> result{};
+  result.reserve(indices.size());
+  for (size_t cluster : order) {
+    result.insert(
+        result.end(),
+        indices.begin() + clusterStarts[cluster] * 3,
+        indices.begin() + clusterStarts[cluster + 1] * 3);
+  }
+  indices.swap(result);
+}
+
+void LveMeshOptimizer::optimizeVertexFetch(
+    std::vector<uint32_t> &indices, std::vector<LveModel::Vertex> &vertices) {
+  std::vector<uint32_t> remap(vertices.size(), UNUSED);
+  std::vector<LveModel::Vertex> result{};
+  result.reserve(vertices.size());
+
+  for (uint32_t &index : indices) {
+    if (remap[index] == UNUSED) {
+      remap[index] = static_cast<uint32_t>(result.size());
+      result.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices.swap(result);
+}
+
+LveMeshOptimizer::CacheStats LveMeshOptimizer::analyzeVertexCache(
+    const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+  CacheStats stats{};
+  if (indices.empty()) {
+    return stats;
+  }
+
+  FifoCache cache{vertexCount, cacheSize};
+  std::vector<bool> used(vertexCount, false);
+  size_t misses = 0;
+  size_t usedVertices = 0;
+  for (uint32_t index : indices) {
+    misses += cache.access(index) ? 1 : 0;
+    if (!used[index]) {
+      used[index] = true;
+      usedVertices++;
+    }
+  }
+
+  stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+  stats.atvr = static_cast<float>(misses) / static_cast<float>(usedVertices);
+  return stats;
+}
+
+}  // namespace lve
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "lve_model.hpp"
+
+// std
+#include <vector>
+
+namespace lve {
+
+// Reorders the index and vertex data of a model for GPU efficiency and generates its LOD chain,
+// after it has been loaded and before it is uploaded. The full detail geometry itself never
+// changes, only its order.
+class LveMeshOptimizer {
+ public:
+  // matches the post-transform cache size Tipsify was tuned for
+  static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+  // clusters may have up to 5% more cache misses than average when optimizing overdraw
+  static constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+  // each LOD targets this fraction of the previous LOD's triangles
+  static constexpr float LOD_RATIO = 0.5f;
+  static constexpr size_t MAX_LOD_COUNT = 6;
+  static constexpr size_t MIN_LOD_TRIANGLES = 32;
+
+  struct CacheStats {
+    float acmr = 0.f;  // average cache miss ratio, transformed vertices per triangle
+    float atvr = 0.f;  // average transform to vertex ratio, 1.0 is optimal
+  };
+
+  struct Report {
+    CacheStats before{};
+    CacheStats after{};
+  };
+
+  // Applies the optimizations selected by flags (LveModel::OptimizeFlagBits) in the order vertex
+  // cache, overdraw, LOD generation, vertex fetch, meshlets. The report covers LOD 0.
+  static Report optimize(LveModel::Builder &builder, uint32_t flags);
+
+  // Appends simplified copies of builder.indices to builder.indices and fills builder.lods. All
+  // LODs share the vertex buffer. Leaves builder.lods empty if the mesh cannot be simplified.
+  static void generateLods(LveModel::Builder &builder, bool optimizeCache = true);
+
+  // Splits LOD 0 into builder.meshlets of consecutive triangles with at most
+  // LveModel::MAX_MESHLET_VERTICES unique vertices and LveModel::MAX_MESHLET_TRIANGLES triangles.
+  // Run after the vertex cache optimization, which keeps consecutive triangles close together.
+  static void buildMeshlets(LveModel::Builder &builder);
+
+  // Quadric error edge collapse simplification (Garland and Heckbert 1997) that only collapses
+  // vertices onto their neighbours, so the result indexes into the unchanged vertex array.
+  // Vertices on attribute seams and mesh borders are locked. resultError receives the largest
+  // object space error introduced, as a distance.
+  static std::vector<uint32_t> simplify(
+      const std::vector<LveModel::Vertex> &vertices,
+      const std::vector<uint32_t> &indices,
+      size_t targetIndexCount,
+      float *resultError = nullptr);
+
+  // Tipsify (Sander et al. 2007), reorders triangles for a FIFO post-transform cache
+  static void optimizeVertexCache(
+      std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+  // Splits the cache optimized order into clusters and sorts them so outward facing clusters draw
+  // first. threshold limits how much the cache efficiency may degrade.
+  static void optimizeOverdraw(
+      std::vector<uint32_t> &indices,
+      const std::vector<LveModel::Vertex> &vertices,
+      float threshold = DEFAULT_OVERDRAW_THRESHOLD,
+      uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+  // Reorders vertices in the order they are first used by indices, dropping unused vertices
+  static void optimizeVertexFetch(
+      std::vector<uint32_t> &indices, std::vector<LveModel::Vertex> &vertices);
+
+  static CacheStats analyzeVertexCache(
+      const std::vector<uint32_t> &indices,
+      size_t vertexCount,
+      uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+};
+
+}  // namespace lve
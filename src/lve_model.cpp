@@ -1,123 +1,404 @@
 #include "lve_model.hpp"
 
-#include "lve_utils.hpp"
+#include "lve_geometry_buffer.hpp"
+#include "lve_mesh_cache.hpp"
+#include "lve_mesh_optimizer.hpp"
+#include "lve_obj_loader.hpp"
+#include "lve_upload_batch.hpp"
+#include "lve_weld_table.hpp"
 
 // libs
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/packing.hpp>
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
-#include <unordered_map>
+#include <filesystem>
+#include <iostream>
+#include <limits>
 
 #ifndef ENGINE_DIR
 #define ENGINE_DIR "../"
 #endif
 
-namespace std {
-template <>
-struct hash<lve::LveModel::Vertex> {
-  size_t operator()(lve::LveModel::Vertex const &vertex) const {
-    size_t seed = 0;
-    lve::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-    return seed;
-  }
-};
-}  // namespace std
-
 namespace lve {
 
-LveModel::LveModel(LveDevice &device, const LveModel::Builder &builder) : lveDevice{device} {
-  createVertexBuffers(builder.vertices);
-  createIndexBuffers(builder.indices);
+LveModel::LveModel(
+    LveDevice &device,
+    const LveModel::Builder &builder,
+    VertexFormat vertexFormat,
+    LveUploadBatch *uploadBatch,
+    LveGeometryBuffer *geometryBuffer)
+    : lveDevice{device}, uploadBatch{uploadBatch}, vertexFormat{vertexFormat} {
+  bounds = builder.computeBounds();
+  allocateGeometry(
+      geometryBuffer,
+      static_cast<uint32_t>(builder.vertices.size()),
+      static_cast<uint32_t>(builder.indices.size()));
+  createBuffers(
+      builder.vertices.data(),
+      static_cast<uint32_t>(builder.vertices.size()),
+      builder.indices.data(),
+      static_cast<uint32_t>(builder.indices.size()));
+  setLods(builder.lods.data(), static_cast<uint32_t>(builder.lods.size()));
+  meshlets = builder.meshlets;
+}
+
+LveModel::LveModel(
+    LveDevice &device,
+    const LveMeshCache &cache,
+    VertexFormat vertexFormat,
+    LveUploadBatch *uploadBatch,
+    LveGeometryBuffer *geometryBuffer)
+    : lveDevice{device}, uploadBatch{uploadBatch}, vertexFormat{vertexFormat} {
+  bounds = cache.bounds();
+  allocateGeometry(geometryBuffer, cache.vertexCount(), cache.indexCount());
+  createBuffers(cache.vertices(), cache.vertexCount(), cache.indices(), cache.indexCount());
+  setLods(cache.lods(), cache.lodCount());
+  meshlets.assign(cache.meshlets(), cache.meshlets() + cache.meshletCount());
 }
 
-LveModel::~LveModel() {}
+LveModel::~LveModel() {
+  if (geometryBuffer != nullptr) {
+    // frames in flight may still draw from the range, or uploads reuse it on another queue
+    LveGeometryBuffer *buffer = geometryBuffer;
+    LveGeometryBuffer::Allocation allocation{vertexOffset, vertexCount, firstIndex, indexCount};
+    lveDevice.destroyDeferred([buffer, allocation]() { buffer->free(allocation); });
+  }
+}
 
 std::unique_ptr<LveModel> LveModel::createModelFromFile(
-    LveDevice &device, const std::string &filepath) {
+    LveDevice &device, const std::string &filepath, uint32_t optimizeFlags) {
+  VertexFormat vertexFormat =
+      optimizeFlags & OPTIMIZE_COMPACT_VERTICES ? VERTEX_FORMAT_COMPACT : VERTEX_FORMAT_FULL;
+
   Builder builder{};
-  builder.loadModel(ENGINE_DIR + filepath);
-  return std::make_unique<LveModel>(device, builder);
+  auto cache = loadFromFile(filepath, optimizeFlags, builder);
+  if (cache != nullptr) {
+    return std::make_unique<LveModel>(device, *cache, vertexFormat);
+  }
+  return std::make_unique<LveModel>(device, builder, vertexFormat);
 }
 
-void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
-  vertexCount = static_cast<uint32_t>(vertices.size());
-  assert(vertexCount >= 3 && "Vertex count must be at least 3");
-  VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-  uint32_t vertexSize = sizeof(vertices[0]);
+std::unique_ptr<LveMeshCache> LveModel::loadFromFile(
+    const std::string &filepath, uint32_t optimizeFlags, Builder &builder) {
+  std::string sourcePath = ENGINE_DIR + filepath;
+  std::string cachePath = LveMeshCache::cachePathFor(sourcePath);
+  uint32_t cacheFlags = optimizeFlags & ~OPTIMIZE_COMPACT_VERTICES;
 
-  LveBuffer stagingBuffer{
-      lveDevice,
-      vertexSize,
-      vertexCount,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-  };
+  auto cache = std::make_unique<LveMeshCache>();
+  if (cache->open(cachePath, sourcePath, cacheFlags)) {
+    return cache;
+  }
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void *)vertices.data());
+  std::error_code error;
+  auto sourceSize = std::filesystem::file_size(sourcePath, error);
+  if (!error && sourceSize >= LveObjLoader::PARALLEL_THRESHOLD) {
+    builder.loadModelParallel(sourcePath);
+  } else {
+    builder.loadModel(sourcePath);
+  }
 
-  vertexBuffer = std::make_unique<LveBuffer>(
-      lveDevice,
-      vertexSize,
-      vertexCount,
-      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (cacheFlags != 0) {
+    auto report = LveMeshOptimizer::optimize(builder, cacheFlags);
+    std::cout << filepath << ": ACMR " << report.before.acmr << " -> " << report.after.acmr
+              << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+  }
+  LveMeshCache::write(cachePath, sourcePath, builder, cacheFlags);
+  return nullptr;
+}
+
+void LveModel::createBuffers(
+    const Vertex *vertices, uint32_t numVertices, const uint32_t *indices, uint32_t numIndices) {
+  if (uploadBatch != nullptr) {
+    createVertexBuffers(vertices, numVertices);
+    createIndexBuffers(indices, numIndices);
+    uploadBatch = nullptr;
+    return;
+  }
+
+  // upload both buffers in a single submission
+  LveUploadBatch batch{lveDevice};
+  uploadBatch = &batch;
+  createVertexBuffers(vertices, numVertices);
+  createIndexBuffers(indices, numIndices);
+  uploadBatch = nullptr;
+  if (!batch.isEmpty()) {
+    batch.submit();
+    batch.wait();
+  }
+  markUploaded();
+}
 
-  lveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+void LveModel::createVertexBuffers(const Vertex *vertices, uint32_t count) {
+  vertexCount = count;
+  assert(vertexCount >= 3 && "Vertex count must be at least 3");
+
+  const void *data = vertices;
+  uint32_t vertexSize = sizeof(Vertex);
+  std::vector<CompactVertex> compactVertices;
+  if (vertexFormat == VERTEX_FORMAT_COMPACT) {
+    compactVertices.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      compactVertices[i] = CompactVertex::encode(vertices[i], bounds);
+    }
+    data = compactVertices.data();
+    vertexSize = sizeof(CompactVertex);
+  }
+
+  if (geometryBuffer != nullptr) {
+    uploadToBuffer(
+        data,
+        VkDeviceSize{vertexSize} * vertexCount,
+        geometryBuffer->getVertexBuffer(),
+        VkDeviceSize{vertexSize} * vertexOffset);
+  } else {
+    vertexBuffer =
+        createDeviceLocalBuffer(data, vertexSize, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+  }
 }
 
-void LveModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
-  indexCount = static_cast<uint32_t>(indices.size());
+void LveModel::createIndexBuffers(const uint32_t *indices, uint32_t count) {
+  indexCount = count;
   hasIndexBuffer = indexCount > 0;
 
   if (!hasIndexBuffer) {
     return;
   }
 
-  VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-  uint32_t indexSize = sizeof(indices[0]);
+  if (geometryBuffer != nullptr) {
+    // shared index buffers are always 32 bit so models of any size can use them
+    indexType = VK_INDEX_TYPE_UINT32;
+    uploadToBuffer(
+        indices,
+        sizeof(uint32_t) * VkDeviceSize{indexCount},
+        geometryBuffer->getIndexBuffer(),
+        sizeof(uint32_t) * VkDeviceSize{firstIndex});
+    return;
+  }
 
-  LveBuffer stagingBuffer{
-      lveDevice,
-      indexSize,
-      indexCount,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-  };
+  // half the index memory and bandwidth whenever every index fits in 16 bits
+  if (vertexCount <= std::numeric_limits<uint16_t>::max()) {
+    std::vector<uint16_t> shortIndices(indices, indices + indexCount);
+    indexType = VK_INDEX_TYPE_UINT16;
+    indexBuffer = createDeviceLocalBuffer(
+        shortIndices.data(),
+        sizeof(uint16_t),
+        indexCount,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+  } else {
+    indexType = VK_INDEX_TYPE_UINT32;
+    indexBuffer = createDeviceLocalBuffer(
+        indices,
+        sizeof(uint32_t),
+        indexCount,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+  }
+}
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void *)indices.data());
+void LveModel::allocateGeometry(
+    LveGeometryBuffer *geometryBuffer, uint32_t vertexCount, uint32_t indexCount) {
+  // models that do not fit or use another vertex format fall back to their own buffers
+  LveGeometryBuffer::Allocation allocation{};
+  if (geometryBuffer != nullptr && geometryBuffer->getVertexFormat() == vertexFormat &&
+      geometryBuffer->allocate(vertexCount, indexCount, allocation)) {
+    this->geometryBuffer = geometryBuffer;
+    vertexOffset = allocation.vertexOffset;
+    firstIndex = allocation.firstIndex;
+  }
+}
+
+std::unique_ptr<LveBuffer> LveModel::createDeviceLocalBuffer(
+    const void *data, uint32_t instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage) {
+  // bound by handle every frame, so the defragmenter may move them once uploaded
+  usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  if (lveDevice.prefersDirectWrite(VkDeviceSize{instanceSize} * instanceCount)) {
+    // written straight into device local memory, no staging copy or submission
+    auto buffer = std::make_unique<LveBuffer>(
+        lveDevice,
+        instanceSize,
+        instanceCount,
+        usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    buffer->map();
+    std::memcpy(buffer->getMappedMemory(), data, buffer->getBufferSize());
+    buffer->flush(VK_WHOLE_SIZE);
+    buffer->unmap();
+    return buffer;
+  }
 
-  indexBuffer = std::make_unique<LveBuffer>(
+  auto buffer = std::make_unique<LveBuffer>(
       lveDevice,
-      indexSize,
-      indexCount,
-      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      instanceSize,
+      instanceCount,
+      usage,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  uploadToBuffer(data, buffer->getBufferSize(), buffer->getBuffer(), 0);
+  return buffer;
+}
+
+void LveModel::uploadToBuffer(
+    const void *data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+  assert(uploadBatch != nullptr && "Buffers can only be uploaded while the model is created");
+  uploadBatch->copyToBuffer(data, size, dstBuffer, dstOffset);
+}
+
+void LveModel::setLods(const Lod *lods, uint32_t count) {
+  if (count == 0) {
+    this->lods = {{0, indexCount, 0.f}};
+  } else {
+    this->lods.assign(lods, lods + count);
+  }
+}
+
+uint32_t LveModel::selectLod(float errorScale, uint32_t currentLod) const {
+  uint32_t lod = std::min(currentLod, getLodCount() - 1);
+  while (lod > 0 && lods[lod].error * errorScale > LOD_ERROR_THRESHOLD) {
+    lod--;
+  }
+  while (lod + 1 < getLodCount() &&
+         lods[lod + 1].error * errorScale < LOD_ERROR_THRESHOLD * (1.f - LOD_HYSTERESIS)) {
+    lod++;
+  }
+  return lod;
+}
+
+glm::mat4 LveModel::getDequantizeMatrix() const {
+  if (vertexFormat != VERTEX_FORMAT_COMPACT) {
+    return glm::mat4{1.f};
+  }
+
+  glm::vec3 extent = bounds.max - bounds.min;
+  glm::mat4 matrix{1.f};
+  matrix[0][0] = extent.x;
+  matrix[1][1] = extent.y;
+  matrix[2][2] = extent.z;
+  matrix[3] = glm::vec4{bounds.min, 1.f};
+  return matrix;
+}
+
+void LveModel::drawVisibleMeshlets(
+    VkCommandBuffer commandBuffer,
+    const glm::mat4 &clipFromObject,
+    const glm::vec3 &cameraPosition,
+    bool coneCulling) {
+  if (meshlets.empty()) {
+    draw(commandBuffer);
+    return;
+  }
+
+  // frustum planes in object space, extracted from the rows of clipFromObject for 0..1 depth
+  glm::mat4 rows = glm::transpose(clipFromObject);
+  glm::vec4 planes[6] = {
+      rows[3] + rows[0],
+      rows[3] - rows[0],
+      rows[3] + rows[1],
+      rows[3] - rows[1],
+      rows[2],
+      rows[3] - rows[2],
+  };
+  for (auto &plane : planes) {
+    plane /= glm::length(glm::vec3{plane});
+  }
+
+  auto isVisible = [&](const Meshlet &meshlet) {
+    for (const auto &plane : planes) {
+      if (glm::dot(glm::vec3{plane}, meshlet.center) + plane.w < -meshlet.radius) {
+        return false;
+      }
+    }
+    if (coneCulling) {
+      glm::vec3 view = meshlet.center - cameraPosition;
+      if (glm::dot(view, meshlet.coneAxis) >=
+          meshlet.coneCutoff * glm::length(view) + meshlet.radius) {
+        return false;
+      }
+    }
+    return true;
+  };
 
-  lveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+  uint32_t rangeFirst = 0;
+  uint32_t rangeCount = 0;
+  for (const auto &meshlet : meshlets) {
+    if (!isVisible(meshlet)) continue;
+
+    if (rangeCount > 0 && rangeFirst + rangeCount == meshlet.firstIndex) {
+      rangeCount += meshlet.indexCount;
+      continue;
+    }
+    if (rangeCount > 0) {
+      drawIndexed(commandBuffer, rangeFirst, rangeCount);
+    }
+    rangeFirst = meshlet.firstIndex;
+    rangeCount = meshlet.indexCount;
+  }
+  if (rangeCount > 0) {
+    drawIndexed(commandBuffer, rangeFirst, rangeCount);
+  }
 }
 
-void LveModel::draw(VkCommandBuffer commandBuffer) {
+void LveModel::draw(VkCommandBuffer commandBuffer, uint32_t lod) {
   if (hasIndexBuffer) {
-    vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+    const Lod &range = lods[std::min(lod, getLodCount() - 1)];
+    drawIndexed(commandBuffer, range.firstIndex, range.indexCount);
   } else {
-    vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    vkCmdDraw(commandBuffer, vertexCount, 1, vertexOffset, 0);
   }
 }
 
+void LveModel::drawIndexed(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count) {
+  vkCmdDrawIndexed(
+      commandBuffer,
+      count,
+      1,
+      firstIndex + first,
+      static_cast<int32_t>(vertexOffset),
+      0);
+}
+
+VkBuffer LveModel::getVertexBuffer() const {
+  return geometryBuffer != nullptr ? geometryBuffer->getVertexBuffer() : vertexBuffer->getBuffer();
+}
+
+void LveModel::markUploaded() {
+  if (vertexBuffer != nullptr) {
+    vertexBuffer->setMovable(true);
+  }
+  if (indexBuffer != nullptr) {
+    indexBuffer->setMovable(true);
+  }
+}
+
+VkDeviceSize LveModel::getMemorySize() const {
+  if (geometryBuffer != nullptr) {
+    VkDeviceSize vertexSize =
+        vertexFormat == VERTEX_FORMAT_COMPACT ? sizeof(CompactVertex) : sizeof(Vertex);
+    return vertexSize * vertexCount + sizeof(uint32_t) * VkDeviceSize{indexCount};
+  }
+  VkDeviceSize size = vertexBuffer->getBufferSize();
+  if (hasIndexBuffer) {
+    size += indexBuffer->getBufferSize();
+  }
+  return size;
+}
+
 void LveModel::bind(VkCommandBuffer commandBuffer) {
+  if (geometryBuffer != nullptr) {
+    geometryBuffer->bind(commandBuffer);
+    return;
+  }
+
   VkBuffer buffers[] = {vertexBuffer->getBuffer()};
   VkDeviceSize offsets[] = {0};
   vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
   if (hasIndexBuffer) {
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
   }
 }
 
@@ -140,6 +421,60 @@ std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDes
   return attributeDescriptions;
 }
 
+LveModel::CompactVertex LveModel::CompactVertex::encode(
+    const Vertex &vertex, const BoundingBox &bounds) {
+  CompactVertex compact{};
+
+  glm::vec3 extent = bounds.max - bounds.min;
+  for (int i = 0; i < 3; i++) {
+    float normalized = extent[i] > 0.f ? (vertex.position[i] - bounds.min[i]) / extent[i] : 0.f;
+    compact.position[i] = static_cast<uint16_t>(glm::packUnorm1x16(normalized));
+  }
+
+  // project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper
+  glm::vec3 n = vertex.normal;
+  float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  glm::vec2 oct{0.f};
+  if (length > 0.f) {
+    n /= length;
+    oct = glm::vec2{n.x, n.y};
+    if (n.z < 0.f) {
+      oct = (1.f - glm::abs(glm::vec2{n.y, n.x})) *
+            glm::vec2{n.x >= 0.f ? 1.f : -1.f, n.y >= 0.f ? 1.f : -1.f};
+    }
+  }
+  compact.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(oct.x));
+  compact.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(oct.y));
+
+  uint32_t color = glm::packUnorm4x8(glm::vec4{vertex.color, 1.f});
+  std::memcpy(compact.color, &color, sizeof(color));
+
+  uint32_t uv = glm::packHalf2x16(vertex.uv);
+  std::memcpy(compact.uv, &uv, sizeof(uv));
+  return compact;
+}
+
+std::vector<VkVertexInputBindingDescription> LveModel::CompactVertex::getBindingDescriptions() {
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+  bindingDescriptions[0].binding = 0;
+  bindingDescriptions[0].stride = sizeof(CompactVertex);
+  bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription>
+LveModel::CompactVertex::getAttributeDescriptions() {
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+  attributeDescriptions.push_back(
+      {0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex, position)});
+  attributeDescriptions.push_back({1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactVertex, color)});
+  attributeDescriptions.push_back({2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal)});
+  attributeDescriptions.push_back({3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv)});
+
+  return attributeDescriptions;
+}
+
 void LveModel::Builder::loadModel(const std::string &filepath) {
   tinyobj::attrib_t attrib;
   std::vector<tinyobj::shape_t> shapes;
@@ -153,7 +488,13 @@ void LveModel::Builder::loadModel(const std::string &filepath) {
   vertices.clear();
   indices.clear();
 
-  std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+  size_t cornerCount = 0;
+  for (const auto &shape : shapes) {
+    cornerCount += shape.mesh.indices.size();
+  }
+  indices.reserve(cornerCount);
+
+  LveWeldTable<Vertex> uniqueVertices{vertices, cornerCount / 3, weldEpsilon};
   for (const auto &shape : shapes) {
     for (const auto &index : shape.mesh.indices) {
       Vertex vertex{};
@@ -187,13 +528,29 @@ void LveModel::Builder::loadModel(const std::string &filepath) {
         };
       }
 
-      if (uniqueVertices.count(vertex) == 0) {
-        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-        vertices.push_back(vertex);
-      }
-      indices.push_back(uniqueVertices[vertex]);
+      indices.push_back(uniqueVertices.weld(vertex));
     }
   }
 }
 
+void LveModel::Builder::loadModelParallel(const std::string &filepath, uint32_t threadCount) {
+  LveObjLoader loader{threadCount};
+  loader.load(filepath, *this);
+}
+
+LveModel::BoundingBox LveModel::Builder::computeBounds() const {
+  BoundingBox box{};
+  if (vertices.empty()) {
+    return box;
+  }
+
+  box.min = vertices[0].position;
+  box.max = vertices[0].position;
+  for (const auto &vertex : vertices) {
+    box.min = glm::min(box.min, vertex.position);
+    box.max = glm::max(box.max, vertex.position);
+  }
+  return box;
+}
+
 }  // namespace lve
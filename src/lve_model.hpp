@@ -13,8 +13,61 @@
 #include <vector>
 
 namespace lve {
+class LveGeometryBuffer;
+class LveMeshCache;
+class LveUploadBatch;
+
 class LveModel {
  public:
+  // Post-load processing applied by createModelFromFile, see LveMeshOptimizer
+  enum OptimizeFlagBits : uint32_t {
+    OPTIMIZE_VERTEX_CACHE = 1 << 0,
+    OPTIMIZE_OVERDRAW = 1 << 1,
+    OPTIMIZE_VERTEX_FETCH = 1 << 2,
+    OPTIMIZE_GENERATE_LODS = 1 << 3,
+    // upload CompactVertex instead of Vertex, applied at upload so not part of the mesh cache
+    OPTIMIZE_COMPACT_VERTICES = 1 << 4,
+    OPTIMIZE_BUILD_MESHLETS = 1 << 5,
+    OPTIMIZE_DEFAULT = OPTIMIZE_VERTEX_CACHE | OPTIMIZE_VERTEX_FETCH | OPTIMIZE_GENERATE_LODS,
+  };
+
+  enum VertexFormat {
+    VERTEX_FORMAT_FULL,
+    VERTEX_FORMAT_COMPACT,
+  };
+
+  // LOD errors are compared against this fraction of half the screen height, about 2 pixels at
+  // 1080p. A coarser LOD is only picked once its error is below (1 - LOD_HYSTERESIS) times the
+  // threshold, so objects near a switching distance do not pop back and forth.
+  static constexpr float LOD_ERROR_THRESHOLD = 0.004f;
+  static constexpr float LOD_HYSTERESIS = 0.25f;
+
+  // Range of the index buffer drawn for one level of detail
+  struct Lod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;  // largest object space distance from the full detail surface
+  };
+
+  static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+  static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+  // Cluster of nearby LOD 0 triangles, a contiguous range of the index buffer that can be culled
+  // as a whole. Bounds are in object space.
+  struct Meshlet {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    glm::vec3 center;    // bounding sphere
+    float radius;
+    glm::vec3 coneAxis;  // average normal of the counter-clockwise triangles
+    float coneCutoff;    // sine of the cone half angle, 1 if the cone cannot be used for culling
+  };
+
+  struct BoundingBox {
+    glm::vec3 min{};
+    glm::vec3 max{};
+  };
+
   struct Vertex {
     glm::vec3 position{};
     glm::vec3 color{};
@@ -30,30 +83,130 @@ class LveModel {
     }
   };
 
+  // 20 byte alternative to Vertex, drawn with shaders/simple_shader_compact.vert. Positions are
+  // normalized to the model bounds and mapped back by getDequantizeMatrix().
+  struct CompactVertex {
+    uint16_t position[4];  // unorm, w unused
+    int16_t normal[2];     // snorm, octahedral encoded
+    uint8_t color[4];      // unorm, a unused
+    uint16_t uv[2];        // half float
+
+    static CompactVertex encode(const Vertex &vertex, const BoundingBox &bounds);
+
+    static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+  };
+
   struct Builder {
     std::vector<Vertex> vertices{};
     std::vector<uint32_t> indices{};
+    // index ranges of each LOD within indices, empty if indices only holds full detail
+    std::vector<Lod> lods{};
+    // clusters covering LOD 0, empty unless built by LveMeshOptimizer::buildMeshlets
+    std::vector<Meshlet> meshlets{};
+    // vertices closer than this are welded together on load, 0 only welds exact duplicates
+    float weldEpsilon = 0.f;
 
     void loadModel(const std::string &filepath);
+    // Same output as loadModel, parses the file on threadCount threads (0 = all hardware threads)
+    void loadModelParallel(const std::string &filepath, uint32_t threadCount = 0);
+    BoundingBox computeBounds() const;
   };
 
-  LveModel(LveDevice &device, const LveModel::Builder &builder);
+  // With an uploadBatch the buffer copies are recorded into it instead of waiting on the queue, the
+  // model must not be drawn until the batch has completed. With a geometryBuffer the model is
+  // sub-allocated from it if it fits, the geometry buffer must outlive the model.
+  LveModel(
+      LveDevice &device,
+      const LveModel::Builder &builder,
+      VertexFormat vertexFormat = VERTEX_FORMAT_FULL,
+      LveUploadBatch *uploadBatch = nullptr,
+      LveGeometryBuffer *geometryBuffer = nullptr);
+  LveModel(
+      LveDevice &device,
+      const LveMeshCache &cache,
+      VertexFormat vertexFormat = VERTEX_FORMAT_FULL,
+      LveUploadBatch *uploadBatch = nullptr,
+      LveGeometryBuffer *geometryBuffer = nullptr);
   ~LveModel();
 
   LveModel(const LveModel &) = delete;
   LveModel &operator=(const LveModel &) = delete;
 
   static std::unique_ptr<LveModel> createModelFromFile(
-      LveDevice &device, const std::string &filepath);
+      LveDevice &device, const std::string &filepath, uint32_t optimizeFlags = OPTIMIZE_DEFAULT);
+
+  // CPU half of createModelFromFile, safe to call from any thread. Returns the mapped mesh cache on
+  // a warm load, otherwise parses and optimizes the model into builder, writes the cache and
+  // returns nullptr.
+  static std::unique_ptr<LveMeshCache> loadFromFile(
+      const std::string &filepath, uint32_t optimizeFlags, Builder &builder);
 
   void bind(VkCommandBuffer commandBuffer);
-  void draw(VkCommandBuffer commandBuffer);
+  void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+
+  // Draws LOD 0 skipping meshlets outside the frustum, adjacent visible meshlets are merged into a
+  // single draw. clipFromObject is projection * view * model (without getDequantizeMatrix()).
+  // Normal cone culling is only valid with back face culling enabled, and needs cameraPosition in
+  // object space. Falls back to draw() for models without meshlets.
+  void drawVisibleMeshlets(
+      VkCommandBuffer commandBuffer,
+      const glm::mat4 &clipFromObject,
+      const glm::vec3 &cameraPosition,
+      bool coneCulling);
+
+  // Picks a LOD given the factor that projects object space error to screen space, that is
+  // scale / (distance * tan(fovy / 2)), and the LOD the object used last frame
+  uint32_t selectLod(float errorScale, uint32_t currentLod) const;
+
+  const BoundingBox &getBounds() const { return bounds; }
+  uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+  uint32_t getMeshletCount() const { return static_cast<uint32_t>(meshlets.size()); }
+  VertexFormat getVertexFormat() const { return vertexFormat; }
+  // Models sharing a geometry buffer return the same buffer and only need to be bound once
+  VkBuffer getVertexBuffer() const;
+  // Bytes of vertex and index data, in its own buffers or in the shared geometry buffer
+  VkDeviceSize getMemorySize() const;
+  // False for models in a shared geometry buffer, destroying them frees no device memory
+  bool ownsBuffers() const { return geometryBuffer == nullptr; }
+  // Call once the upload batch the model was created with has completed, so LveDefragmenter may
+  // move the model's own buffers. Models uploading through their own batch call it themselves.
+  void markUploaded();
+
+  // Maps vertex positions to object space, to be folded into the model matrix. Identity unless the
+  // model uses quantized CompactVertex positions.
+  glm::mat4 getDequantizeMatrix() const;
 
  private:
-  void createVertexBuffers(const std::vector<Vertex> &vertices);
-  void createIndexBuffers(const std::vector<uint32_t> &indices);
+  // Uploads through uploadBatch if set, otherwise through a batch of its own that it waits for
+  void createBuffers(
+      const Vertex *vertices, uint32_t numVertices, const uint32_t *indices, uint32_t numIndices);
+  void createVertexBuffers(const Vertex *vertices, uint32_t count);
+  void createIndexBuffers(const uint32_t *indices, uint32_t count);
+  void setLods(const Lod *lods, uint32_t count);
+  void allocateGeometry(
+      LveGeometryBuffer *geometryBuffer, uint32_t vertexCount, uint32_t indexCount);
+  std::unique_ptr<LveBuffer> createDeviceLocalBuffer(
+      const void *data,
+      uint32_t instanceSize,
+      uint32_t instanceCount,
+      VkBufferUsageFlags usage);
+  void uploadToBuffer(
+      const void *data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset);
+  // first is relative to this model's indices
+  void drawIndexed(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count);
 
   LveDevice &lveDevice;
+  LveUploadBatch *uploadBatch = nullptr;  // only set while constructing
+  BoundingBox bounds{};
+  std::vector<Lod> lods{};
+  std::vector<Meshlet> meshlets{};
+  VertexFormat vertexFormat;
+
+  // vertexBuffer and indexBuffer are only used without a geometry buffer
+  LveGeometryBuffer *geometryBuffer = nullptr;
+  uint32_t vertexOffset = 0;
+  uint32_t firstIndex = 0;
 
   std::unique_ptr<LveBuffer> vertexBuffer;
   uint32_t vertexCount;
@@ -61,5 +214,6 @@ class LveModel {
   bool hasIndexBuffer = false;
   std::unique_ptr<LveBuffer> indexBuffer;
   uint32_t indexCount;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT32;
 };
 }  // namespace lve
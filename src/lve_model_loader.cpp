@@ -0,0 +1,204 @@
+#include "lve_model_loader.hpp"
+
+#include "lve_mesh_cache.hpp"
+#include "lve_utils.hpp"
+
+// std
+#include <algorithm>
+#include <iterator>
+
+namespace lve {
+
+LveModelLoader::LveModelLoader(
+    LveDevice &device, LveGeometryBuffer *geometryBuffer, uint32_t threadCount)
+    : lveDevice{device}, geometryBuffer{geometryBuffer} {
+  if (threadCount == 0) {
+    threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+  }
+  workers.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; i++) {
+    workers.emplace_back([this] { workerLoop(); });
+  }
+}
+
+LveModelLoader::~LveModelLoader() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  jobAvailable.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  // buffers and staging memory may still be in use by the queue
+  for (auto &upload : uploads) {
+    upload.batch->wait();
+  }
+}
+
+std::shared_future<std::shared_ptr<LveModel>> LveModelLoader::load(
+    const std::string &filepath, uint32_t optimizeFlags) {
+  auto job = std::make_unique<Job>();
+  job->filepath = filepath;
+  job->optimizeFlags = optimizeFlags;
+  auto future = job->promise.get_future().share();
+
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    queuedJobs.push_back(std::move(job));
+  }
+  jobAvailable.notify_one();
+  return future;
+}
+
+void LveModelLoader::update() {
+  // publish models whose uploads have finished
+  for (auto it = uploads.begin(); it != uploads.end();) {
+    if (!it->batch->isComplete()) {
+      ++it;
+      continue;
+    }
+    for (auto &model : it->models) {
+      model.second->markUploaded();
+      model.first->promise.set_value(std::move(model.second));
+    }
+    it = uploads.erase(it);
+  }
+  for (auto it = modelsByContent.begin(); it != modelsByContent.end();) {
+    it = it->second.expired() ? modelsByContent.erase(it) : std::next(it);
+  }
+
+  std::vector<std::unique_ptr<Job>> jobs;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    jobs.swap(parsedJobs);
+  }
+  if (jobs.empty()) {
+    return;
+  }
+
+  // record every parsed model into a single submission
+  Upload upload{};
+  upload.batch = std::make_unique<LveUploadBatch>(lveDevice);
+  for (auto &job : jobs) {
+    if (job->error) {
+      job->promise.set_exception(job->error);
+      continue;
+    }
+
+    auto shared = modelsByContent.find(job->contentHash);
+    if (shared != modelsByContent.end()) {
+      if (auto model = shared->second.lock()) {
+        shareModel(std::move(job), std::move(model), upload);
+        continue;
+      }
+      modelsByContent.erase(shared);
+    }
+
+    LveModel::VertexFormat vertexFormat = job->optimizeFlags & LveModel::OPTIMIZE_COMPACT_VERTICES
+                                              ? LveModel::VERTEX_FORMAT_COMPACT
+                                              : LveModel::VERTEX_FORMAT_FULL;
+    try {
+      LveUploadBatch *batch = upload.batch.get();
+      std::shared_ptr<LveModel> model =
+          job->cache != nullptr
+              ? std::make_shared<LveModel>(
+                    lveDevice, *job->cache, vertexFormat, batch, geometryBuffer)
+              : std::make_shared<LveModel>(
+                    lveDevice, job->builder, vertexFormat, batch, geometryBuffer);
+      // the cpu copy is no longer needed once staged
+      job->cache.reset();
+      job->builder = LveModel::Builder{};
+      modelsByContent[job->contentHash] = model;
+      upload.models.emplace_back(std::move(job), std::move(model));
+    } catch (...) {
+      job->promise.set_exception(std::current_exception());
+    }
+  }
+
+  if (upload.models.empty()) {
+    // only errors or models shared with earlier uploads
+    return;
+  }
+  upload.batch->submit();
+  uploads.push_back(std::move(upload));
+}
+
+size_t LveModelLoader::pendingCount() const {
+  size_t count = 0;
+  for (auto &upload : uploads) {
+    count += upload.models.size();
+  }
+  std::lock_guard<std::mutex> lock{mutex};
+  return count + queuedJobs.size() + activeJobs + parsedJobs.size();
+}
+
+void LveModelLoader::workerLoop() {
+  while (true) {
+    std::unique_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      jobAvailable.wait(lock, [this] { return stopping || !queuedJobs.empty(); });
+      if (stopping) {
+        return;
+      }
+      job = std::move(queuedJobs.front());
+      queuedJobs.pop_front();
+      activeJobs++;
+    }
+
+    try {
+      job->cache = LveModel::loadFromFile(job->filepath, job->optimizeFlags, job->builder);
+      job->contentHash = hashContent(*job);
+    } catch (...) {
+      job->error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    parsedJobs.push_back(std::move(job));
+    activeJobs--;
+  }
+}
+
+uint64_t LveModelLoader::hashContent(const Job &job) {
+  const LveModel::Vertex *vertices = job.builder.vertices.data();
+  size_t vertexCount = job.builder.vertices.size();
+  const uint32_t *indices = job.builder.indices.data();
+  size_t indexCount = job.builder.indices.size();
+  if (job.cache != nullptr) {
+    vertices = job.cache->vertices();
+    vertexCount = job.cache->vertexCount();
+    indices = job.cache->indices();
+    indexCount = job.cache->indexCount();
+  }
+
+  // LODs and meshlets are derived from the geometry and the flags, so they need not be hashed
+  uint64_t hash = hashBytes(&job.optimizeFlags, sizeof(job.optimizeFlags));
+  hash = hashBytes(vertices, vertexCount * sizeof(LveModel::Vertex), hash);
+  return hashBytes(indices, indexCount * sizeof(uint32_t), hash);
+}
+
+void LveModelLoader::shareModel(
+    std::unique_ptr<Job> job, std::shared_ptr<LveModel> model, Upload &upload) {
+  auto isWriting = [&model](const Upload &candidate) {
+    for (auto &entry : candidate.models) {
+      if (entry.second == model) return true;
+    }
+    return false;
+  };
+
+  if (isWriting(upload)) {
+    upload.models.emplace_back(std::move(job), std::move(model));
+    return;
+  }
+  for (auto &inFlight : uploads) {
+    if (isWriting(inFlight)) {
+      inFlight.models.emplace_back(std::move(job), std::move(model));
+      return;
+    }
+  }
+  job->promise.set_value(std::move(model));
+}
+
+}  // namespace lve
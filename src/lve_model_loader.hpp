@@ -0,0 +1,91 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_geometry_buffer.hpp"
+#include "lve_model.hpp"
+#include "lve_upload_batch.hpp"
+
+// std
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+// Loads models in the background. Files are parsed, optimized and cached on worker threads, and
+// the GPU uploads of everything parsed since the last update() are recorded into one
+// LveUploadBatch. A model's future becomes ready once its batch has finished executing, so it can
+// be drawn as soon as it is retrieved.
+//
+// Models with identical geometry and flags share one LveModel for as long as any reference to it
+// is alive, even when they were loaded from different files.
+class LveModelLoader {
+ public:
+  // threadCount 0 uses one worker per hardware thread, leaving one for the main thread. Models are
+  // sub-allocated from geometryBuffer when given, see LveModel.
+  LveModelLoader(
+      LveDevice &device, LveGeometryBuffer *geometryBuffer = nullptr, uint32_t threadCount = 0);
+  ~LveModelLoader();
+
+  LveModelLoader(const LveModelLoader &) = delete;
+  LveModelLoader &operator=(const LveModelLoader &) = delete;
+
+  // Queues filepath for loading, same arguments as LveModel::createModelFromFile. Load errors are
+  // rethrown by the future's get().
+  std::shared_future<std::shared_ptr<LveModel>> load(
+      const std::string &filepath, uint32_t optimizeFlags = LveModel::OPTIMIZE_DEFAULT);
+
+  // Must be called regularly from the thread that owns the device, such as once per frame.
+  // Creates buffers for parsed models, submits their uploads and completes finished futures.
+  void update();
+
+  // Number of models queued or in flight
+  size_t pendingCount() const;
+
+ private:
+  struct Job {
+    std::string filepath;
+    uint32_t optimizeFlags;
+    std::promise<std::shared_ptr<LveModel>> promise;
+
+    // filled in by a worker
+    LveModel::Builder builder{};
+    std::unique_ptr<LveMeshCache> cache;
+    uint64_t contentHash = 0;
+    std::exception_ptr error;
+  };
+
+  struct Upload {
+    std::unique_ptr<LveUploadBatch> batch;
+    std::vector<std::pair<std::unique_ptr<Job>, std::shared_ptr<LveModel>>> models;
+  };
+
+  void workerLoop();
+  static uint64_t hashContent(const Job &job);
+  // queues job to complete with model, alongside the upload that is still writing it if any
+  void shareModel(std::unique_ptr<Job> job, std::shared_ptr<LveModel> model, Upload &upload);
+
+  LveDevice &lveDevice;
+  LveGeometryBuffer *geometryBuffer;
+
+  mutable std::mutex mutex;
+  std::condition_variable jobAvailable;
+  std::deque<std::unique_ptr<Job>> queuedJobs;
+  std::vector<std::unique_ptr<Job>> parsedJobs;
+  size_t activeJobs = 0;
+  bool stopping = false;
+
+  // only accessed from update()
+  std::vector<Upload> uploads;
+  std::unordered_map<uint64_t, std::weak_ptr<LveModel>> modelsByContent;
+
+  std::vector<std::thread> workers;
+};
+
+}  // namespace lve
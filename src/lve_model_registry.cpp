@@ -0,0 +1,106 @@
+#include "lve_model_registry.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace lve {
+
+LveModelRegistry::LveModelRegistry(
+    LveDevice &device, LveGeometryBuffer *geometryBuffer, uint32_t loaderThreadCount)
+    : lveDevice{device}, loader{device, geometryBuffer, loaderThreadCount} {}
+
+std::shared_future<std::shared_ptr<LveModel>> LveModelRegistry::load(
+    const std::string &filepath, uint32_t optimizeFlags) {
+  std::string key = filepath + '#' + std::to_string(optimizeFlags);
+
+  auto found = models.find(key);
+  if (found != models.end()) {
+    Entry &entry = found->second;
+    if (entry.pending.valid()) {
+      return entry.pending;
+    }
+    if (entry.model != nullptr) {
+      entry.lastUsedFrame = frame;
+      std::promise<std::shared_ptr<LveModel>> ready;
+      ready.set_value(entry.model);
+      return ready.get_future().share();
+    }
+  }
+
+  Entry &entry = models[key];
+  entry.pending = loader.load(filepath, optimizeFlags);
+  entry.model.reset();
+  entry.lastUsedFrame = frame;
+  return entry.pending;
+}
+
+void LveModelRegistry::update() {
+  loader.update();
+  frame++;
+
+  bool hasUnusedModels = false;
+  for (auto it = models.begin(); it != models.end();) {
+    Entry &entry = it->second;
+    if (entry.pending.valid() &&
+        entry.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      try {
+        entry.model = entry.pending.get();
+      } catch (...) {
+        // the error reaches whoever requested the model, a later load retries
+      }
+      entry.pending = {};
+    }
+
+    if (!entry.pending.valid() && entry.model == nullptr) {
+      it = models.erase(it);
+      continue;
+    }
+    // anything beyond the registry's own reference is an object or request using the model
+    if (entry.pending.valid() || entry.model.use_count() > 1) {
+      entry.lastUsedFrame = frame;
+    } else {
+      hasUnusedModels = true;
+    }
+    ++it;
+  }
+
+  if (frame > lastEvictionFrame + LveSwapChain::MAX_FRAMES_IN_FLIGHT) {
+    evictedBytes = 0;
+  }
+  if (hasUnusedModels) {
+    // memory of models evicted in the last frames is still counted as used
+    VkDeviceSize overBudget = lveDevice.getMemoryOverBudget(EVICTION_THRESHOLD);
+    if (overBudget > evictedBytes) {
+      VkDeviceSize freed = evictUnused(overBudget - evictedBytes);
+      if (freed > 0) {
+        evictedBytes += freed;
+        lastEvictionFrame = frame;
+      }
+    }
+  }
+}
+
+VkDeviceSize LveModelRegistry::evictUnused(VkDeviceSize bytes) {
+  // models in the shared geometry buffer stay cached, evicting them would not lower heap usage
+  std::vector<std::unordered_map<std::string, Entry>::iterator> unused;
+  for (auto it = models.begin(); it != models.end(); ++it) {
+    if (it->second.lastUsedFrame != frame && it->second.model->ownsBuffers()) {
+      unused.push_back(it);
+    }
+  }
+  std::sort(unused.begin(), unused.end(), [](const auto &a, const auto &b) {
+    return a->second.lastUsedFrame < b->second.lastUsedFrame;
+  });
+
+  VkDeviceSize freed = 0;
+  for (auto it : unused) {
+    if (freed >= bytes) break;
+    freed += it->second.model->getMemorySize();
+    models.erase(it);
+  }
+  return freed;
+}
+
+}  // namespace lve
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "lve_model.hpp"
+#include "lve_model_loader.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+// Hands out one shared LveModel per model file, so memory and load time scale with the number of
+// unique meshes rather than the number of objects using them. Models stay cached after the last
+// object using them lets go, and are evicted least recently used first once device memory use
+// approaches its budget. Models in a shared geometry buffer are never evicted, as that would not
+// free any device memory. Identical geometry in different files is shared by the underlying
+// LveModelLoader.
+class LveModelRegistry {
+ public:
+  // fraction of the device local memory budget above which unused models are evicted
+  static constexpr float EVICTION_THRESHOLD = .9f;
+
+  LveModelRegistry(
+      LveDevice &device,
+      LveGeometryBuffer *geometryBuffer = nullptr,
+      uint32_t loaderThreadCount = 0);
+
+  LveModelRegistry(const LveModelRegistry &) = delete;
+  LveModelRegistry &operator=(const LveModelRegistry &) = delete;
+
+  // Returns the model loaded from filepath with optimizeFlags, loading it in the background if it
+  // is not cached. Requests for a model that is still loading share the same future.
+  std::shared_future<std::shared_ptr<LveModel>> load(
+      const std::string &filepath, uint32_t optimizeFlags = LveModel::OPTIMIZE_DEFAULT);
+
+  // Call once per frame, see LveModelLoader::update. Also evicts unused models while device memory
+  // use is above EVICTION_THRESHOLD of the budget.
+  void update();
+
+  // Number of models currently cached or loading
+  size_t size() const { return models.size(); }
+
+ private:
+  struct Entry {
+    std::shared_future<std::shared_ptr<LveModel>> pending;  // valid while loading
+    std::shared_ptr<LveModel> model;
+    uint64_t lastUsedFrame = 0;
+  };
+
+  // Releases unused models with their own buffers, least recently used first, until about bytes
+  // were freed. Returns the bytes freed.
+  VkDeviceSize evictUnused(VkDeviceSize bytes);
+
+  LveDevice &lveDevice;
+  LveModelLoader loader;
+  std::unordered_map<std::string, Entry> models;
+  uint64_t frame = 0;
+  // evicted memory is only released once frames in flight are done with it
+  VkDeviceSize evictedBytes = 0;
+  uint64_t lastEvictionFrame = 0;
+};
+
+}  // namespace lve
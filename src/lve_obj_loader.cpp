@@ -0,0 +1,535 @@
+#include "lve_obj_loader.hpp"
+
+#include "lve_mapped_file.hpp"
+#include "lve_weld_table.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace lve {
+
+namespace {
+
+constexpr int32_t MISSING_INDEX = std::numeric_limits<int32_t>::min();
+constexpr size_t MIN_CHUNK_SIZE = 1024 * 1024;
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+// Index into one of the attribute arrays. Relative (negative) OBJ indices are stored relative to
+// the start of the chunk until the chunk's offset in the merged arrays is known
+struct ObjIndex {
+  int32_t value = MISSING_INDEX;
+  bool relative = false;
+};
+
+struct ObjCorner {
+  ObjIndex position;
+  ObjIndex texcoord;
+  ObjIndex normal;
+};
+
+// Resolved attribute indices of a triangle corner, -1 for missing attributes. A third the size of
+// LveModel::Vertex, which is only built when welding
+struct ObjVertexIndex {
+  int32_t position;
+  int32_t normal;
+  int32_t texcoord;
+};
+
+struct ObjChunk {
+  const char *begin;
+  const char *end;
+
+  std::vector<float> positions;
+  std::vector<float> colors;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+  std::vector<ObjCorner> corners;
+  std::vector<uint32_t> faceSizes;
+
+  // offsets of this chunk's attributes in the merged attribute arrays
+  size_t firstPosition = 0;
+  size_t firstNormal = 0;
+  size_t firstTexcoord = 0;
+
+  // three per triangle, in file order
+  std::vector<ObjVertexIndex> triangleCorners;
+};
+
+struct ObjAttributes {
+  std::vector<float> positions;
+  std::vector<float> colors;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+};
+
+// Runs task(i) for i in [0, count) on up to threadCount threads, rethrowing the first exception
+void parallelFor(size_t count, uint32_t threadCount, const std::function<void(size_t)> &task) {
+  std::atomic<size_t> next{0};
+  std::exception_ptr error = nullptr;
+  std::mutex errorMutex;
+
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++) {
+      try {
+        task(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{errorMutex};
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  size_t workerCount = std::min<size_t>(threadCount, count);
+  for (size_t i = 1; i < workerCount; i++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : workers) {
+    thread.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+void skipSpaces(const char *&p, const char *end) {
+  while (p < end && isSpace(*p)) p++;
+}
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Locale independent float parser, leaves p untouched if no number is found
+bool parseFloat(const char *&p, const char *end, float &value) {
+  static const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                       1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                       1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  const char *s = p;
+  skipSpaces(s, end);
+
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+')) {
+    negative = *s == '-';
+    s++;
+  }
+
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  int digitCount = 0;
+  int significantDigits = 0;
+
+  auto addDigit = [&](char c) {
+    if (significantDigits < 19) {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(c - '0');
+      if (mantissa != 0) significantDigits++;
+      return true;
+    }
+    return false;
+  };
+
+  while (s < end && isDigit(*s)) {
+    if (!addDigit(*s)) exponent++;
+    digitCount++;
+    s++;
+  }
+  if (s < end && *s == '.') {
+    s++;
+    while (s < end && isDigit(*s)) {
+      if (addDigit(*s)) exponent--;
+      digitCount++;
+      s++;
+    }
+  }
+  if (digitCount == 0) {
+    return false;
+  }
+
+  if (s < end && (*s == 'e' || *s == 'E')) {
+    const char *e = s + 1;
+    bool negativeExponent = false;
+    if (e < end && (*e == '-' || *e == '+')) {
+      negativeExponent = *e == '-';
+      e++;
+    }
+    if (e < end && isDigit(*e)) {
+      int explicitExponent = 0;
+      while (e < end && isDigit(*e)) {
+        if (explicitExponent < 10000) explicitExponent = explicitExponent * 10 + (*e - '0');
+        e++;
+      }
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
+      s = e;
+    }
+  }
+
+  double result = static_cast<double>(mantissa);
+  if (exponent < 0) {
+    result = -exponent <= 22 ? result / powersOfTen[-exponent] : result * std::pow(10.0, exponent);
+  } else if (exponent > 0) {
+    result = exponent <= 22 ? result * powersOfTen[exponent] : result * std::pow(10.0, exponent);
+  }
+
+  value = static_cast<float>(negative ? -result : result);
+  p = s;
+  return true;
+}
+
+bool parseInt(const char *&p, const char *end, int64_t &value) {
+  const char *s = p;
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+')) {
+    negative = *s == '-';
+    s++;
+  }
+  if (s >= end || !isDigit(*s)) {
+    return false;
+  }
+
+  int64_t result = 0;
+  while (s < end && isDigit(*s)) {
+    if (result < std::numeric_limits<int32_t>::max()) result = result * 10 + (*s - '0');
+    s++;
+  }
+  value = negative ? -result : result;
+  p = s;
+  return true;
+}
+
+ObjIndex toObjIndex(int64_t rawIndex, size_t localCount) {
+  ObjIndex index{};
+  if (rawIndex > 0 && rawIndex <= std::numeric_limits<int32_t>::max()) {
+    index.value = static_cast<int32_t>(rawIndex - 1);
+  } else if (rawIndex < 0 && -rawIndex <= std::numeric_limits<int32_t>::max()) {
+    index.value = static_cast<int32_t>(static_cast<int64_t>(localCount) + rawIndex);
+    index.relative = true;
+  } else {
+    throw std::runtime_error("invalid index in obj face record");
+  }
+  return index;
+}
+
+void parseFace(const char *p, const char *end, ObjChunk &chunk) {
+  size_t positionCount = chunk.positions.size() / 3;
+  size_t texcoordCount = chunk.texcoords.size() / 2;
+  size_t normalCount = chunk.normals.size() / 3;
+
+  uint32_t faceSize = 0;
+  while (true) {
+    skipSpaces(p, end);
+    if (p >= end) break;
+
+    ObjCorner corner{};
+    int64_t rawIndex;
+    if (!parseInt(p, end, rawIndex)) {
+      throw std::runtime_error("failed to parse obj face record");
+    }
+    corner.position = toObjIndex(rawIndex, positionCount);
+
+    if (p < end && *p == '/') {
+      p++;
+      if (parseInt(p, end, rawIndex)) {
+        corner.texcoord = toObjIndex(rawIndex, texcoordCount);
+      }
+      if (p < end && *p == '/') {
+        p++;
+        if (parseInt(p, end, rawIndex)) {
+          corner.normal = toObjIndex(rawIndex, normalCount);
+        }
+      }
+    }
+
+    // skip anything unexpected up to the next separator
+    while (p < end && !isSpace(*p)) p++;
+
+    chunk.corners.push_back(corner);
+    faceSize++;
+  }
+
+  if (faceSize < 3) {
+    // degenerate face, dropped the same way tinyobj does
+    chunk.corners.resize(chunk.corners.size() - faceSize);
+    return;
+  }
+  chunk.faceSizes.push_back(faceSize);
+}
+
+void parseLine(const char *p, const char *end, ObjChunk &chunk) {
+  skipSpaces(p, end);
+  size_t length = end - p;
+  if (length < 2 || p[0] == '#') {
+    return;
+  }
+
+  if (p[0] == 'v' && isSpace(p[1])) {
+    p += 2;
+    float x = 0.f, y = 0.f, z = 0.f;
+    parseFloat(p, end, x);
+    parseFloat(p, end, y);
+    parseFloat(p, end, z);
+    chunk.positions.insert(chunk.positions.end(), {x, y, z});
+
+    float r, g, b;
+    bool foundColor = parseFloat(p, end, r) && parseFloat(p, end, g) && parseFloat(p, end, b);
+    if (!foundColor) {
+      r = g = b = 1.f;
+    }
+    chunk.colors.insert(chunk.colors.end(), {r, g, b});
+  } else if (length >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+    p += 3;
+    float x = 0.f, y = 0.f, z = 0.f;
+    parseFloat(p, end, x);
+    parseFloat(p, end, y);
+    parseFloat(p, end, z);
+    chunk.normals.insert(chunk.normals.end(), {x, y, z});
+  } else if (length >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+    p += 3;
+    float u = 0.f, v = 0.f;
+    parseFloat(p, end, u);
+    parseFloat(p, end, v);
+    chunk.texcoords.insert(chunk.texcoords.end(), {u, v});
+  } else if (p[0] == 'f' && isSpace(p[1])) {
+    parseFace(p + 2, end, chunk);
+  }
+}
+
+void parseChunk(ObjChunk &chunk) {
+  const char *p = chunk.begin;
+  while (p < chunk.end) {
+    const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', chunk.end - p));
+    if (lineEnd == nullptr) {
+      lineEnd = chunk.end;
+    }
+    parseLine(p, lineEnd, chunk);
+    p = lineEnd + 1;
+  }
+}
+
+int64_t resolveIndex(const ObjIndex &index, size_t first, size_t count) {
+  if (index.value == MISSING_INDEX) {
+    return -1;
+  }
+  int64_t resolved = index.relative ? static_cast<int64_t>(first) + index.value : index.value;
+  if (resolved < 0 || resolved >= static_cast<int64_t>(count)) {
+    throw std::runtime_error("obj face references an attribute out of range");
+  }
+  return resolved;
+}
+
+LveModel::Vertex makeVertex(const ObjVertexIndex &corner, const ObjAttributes &attributes) {
+  LveModel::Vertex vertex{};
+  if (corner.position >= 0) {
+    size_t position = corner.position;
+    vertex.position = {
+        attributes.positions[3 * position + 0],
+        attributes.positions[3 * position + 1],
+        attributes.positions[3 * position + 2],
+    };
+    vertex.color = {
+        attributes.colors[3 * position + 0],
+        attributes.colors[3 * position + 1],
+        attributes.colors[3 * position + 2],
+    };
+  }
+  if (corner.normal >= 0) {
+    size_t normal = corner.normal;
+    vertex.normal = {
+        attributes.normals[3 * normal + 0],
+        attributes.normals[3 * normal + 1],
+        attributes.normals[3 * normal + 2],
+    };
+  }
+  if (corner.texcoord >= 0) {
+    size_t texcoord = corner.texcoord;
+    vertex.uv = {
+        attributes.texcoords[2 * texcoord + 0],
+        attributes.texcoords[2 * texcoord + 1],
+    };
+  }
+  return vertex;
+}
+
+void buildTriangleCorners(ObjChunk &chunk, const ObjAttributes &attributes) {
+  size_t positionCount = attributes.positions.size() / 3;
+  size_t normalCount = attributes.normals.size() / 3;
+  size_t texcoordCount = attributes.texcoords.size() / 2;
+
+  auto resolveCorner = [&](const ObjCorner &corner) {
+    ObjVertexIndex index{};
+    index.position = static_cast<int32_t>(
+        resolveIndex(corner.position, chunk.firstPosition, positionCount));
+    index.normal =
+        static_cast<int32_t>(resolveIndex(corner.normal, chunk.firstNormal, normalCount));
+    index.texcoord =
+        static_cast<int32_t>(resolveIndex(corner.texcoord, chunk.firstTexcoord, texcoordCount));
+    return index;
+  };
+  auto position = [&](const ObjVertexIndex &corner) {
+    if (corner.position < 0) {
+      return glm::vec3{0.f};
+    }
+    const float *p = &attributes.positions[3 * static_cast<size_t>(corner.position)];
+    return glm::vec3{p[0], p[1], p[2]};
+  };
+
+  size_t triangleCount = 0;
+  for (uint32_t faceSize : chunk.faceSizes) {
+    triangleCount += faceSize - 2;
+  }
+  chunk.triangleCorners.reserve(triangleCount * 3);
+
+  size_t cornerOffset = 0;
+  for (uint32_t faceSize : chunk.faceSizes) {
+    const ObjCorner *face = &chunk.corners[cornerOffset];
+    cornerOffset += faceSize;
+
+    if (faceSize == 4) {
+      // split quads along the shorter diagonal, matching tinyobj
+      ObjVertexIndex v[4] = {
+          resolveCorner(face[0]),
+          resolveCorner(face[1]),
+          resolveCorner(face[2]),
+          resolveCorner(face[3])};
+      glm::vec3 e02 = position(v[2]) - position(v[0]);
+      glm::vec3 e13 = position(v[3]) - position(v[1]);
+      if (glm::dot(e02, e02) < glm::dot(e13, e13)) {
+        chunk.triangleCorners.insert(chunk.triangleCorners.end(), {v[0], v[1], v[2]});
+        chunk.triangleCorners.insert(chunk.triangleCorners.end(), {v[0], v[2], v[3]});
+      } else {
+        chunk.triangleCorners.insert(chunk.triangleCorners.end(), {v[0], v[1], v[3]});
+        chunk.triangleCorners.insert(chunk.triangleCorners.end(), {v[1], v[2], v[3]});
+      }
+      continue;
+    }
+
+    // triangles and larger polygons are emitted as a fan
+    ObjVertexIndex first = resolveCorner(face[0]);
+    ObjVertexIndex previous = resolveCorner(face[1]);
+    for (uint32_t i = 2; i < faceSize; i++) {
+      ObjVertexIndex current = resolveCorner(face[i]);
+      chunk.triangleCorners.insert(chunk.triangleCorners.end(), {first, previous, current});
+      previous = current;
+    }
+  }
+
+  // free parse results early, very large models can have several GB of them
+  chunk.corners = {};
+  chunk.faceSizes = {};
+}
+
+}  // namespace
+
+LveObjLoader::LveObjLoader(uint32_t threadCount) : threadCount{threadCount} {
+  if (this->threadCount == 0) {
+    this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+void LveObjLoader::load(const std::string &filepath, LveModel::Builder &builder) const {
+  LveMappedFile file{filepath};
+  const char *data = file.data();
+  size_t size = file.size();
+
+  // split into chunks on line boundaries
+  size_t chunkCount =
+      std::max<size_t>(1, std::min(size / MIN_CHUNK_SIZE, threadCount * CHUNKS_PER_THREAD));
+  std::vector<ObjChunk> chunks(chunkCount);
+  const char *chunkBegin = data;
+  for (size_t i = 0; i < chunkCount; i++) {
+    const char *chunkEnd = data + size;
+    if (i + 1 < chunkCount) {
+      chunkEnd = std::max(chunkBegin, data + (size * (i + 1)) / chunkCount);
+      const char *newline =
+          static_cast<const char *>(std::memchr(chunkEnd, '\n', (data + size) - chunkEnd));
+      chunkEnd = newline ? newline + 1 : data + size;
+    }
+    chunks[i].begin = chunkBegin;
+    chunks[i].end = chunkEnd;
+    chunkBegin = chunkEnd;
+  }
+
+  parallelFor(chunkCount, threadCount, [&](size_t i) { parseChunk(chunks[i]); });
+
+  // merge attributes in file order
+  size_t positionCount = 0, normalCount = 0, texcoordCount = 0;
+  for (auto &chunk : chunks) {
+    chunk.firstPosition = positionCount;
+    chunk.firstNormal = normalCount;
+    chunk.firstTexcoord = texcoordCount;
+    positionCount += chunk.positions.size() / 3;
+    normalCount += chunk.normals.size() / 3;
+    texcoordCount += chunk.texcoords.size() / 2;
+  }
+
+  ObjAttributes attributes{};
+  attributes.positions.resize(positionCount * 3);
+  attributes.colors.resize(positionCount * 3);
+  attributes.normals.resize(normalCount * 3);
+  attributes.texcoords.resize(texcoordCount * 2);
+  parallelFor(chunkCount, threadCount, [&](size_t i) {
+    auto &chunk = chunks[i];
+    std::copy(
+        chunk.positions.begin(),
+        chunk.positions.end(),
+        attributes.positions.begin() + chunk.firstPosition * 3);
+    std::copy(
+        chunk.colors.begin(),
+        chunk.colors.end(),
+        attributes.colors.begin() + chunk.firstPosition * 3);
+    std::copy(
+        chunk.normals.begin(),
+        chunk.normals.end(),
+        attributes.normals.begin() + chunk.firstNormal * 3);
+    std::copy(
+        chunk.texcoords.begin(),
+        chunk.texcoords.end(),
+        attributes.texcoords.begin() + chunk.firstTexcoord * 2);
+    chunk.positions = {};
+    chunk.colors = {};
+    chunk.normals = {};
+    chunk.texcoords = {};
+  });
+
+  parallelFor(chunkCount, threadCount, [&](size_t i) {
+    buildTriangleCorners(chunks[i], attributes);
+  });
+
+  size_t cornerCount = 0;
+  for (auto &chunk : chunks) {
+    cornerCount += chunk.triangleCorners.size();
+  }
+
+  // deduplicate serially in file order so the output is independent of the thread count
+  builder.vertices.clear();
+  builder.indices.clear();
+  builder.indices.reserve(cornerCount);
+
+  // expects one unique vertex per triangle, twice what a closed mesh needs, to leave room for
+  // vertices split at normal and uv seams
+  LveWeldTable<LveModel::Vertex> uniqueVertices{
+      builder.vertices,
+      cornerCount / 3,
+      builder.weldEpsilon};
+  for (auto &chunk : chunks) {
+    for (const auto &corner : chunk.triangleCorners) {
+      builder.indices.push_back(uniqueVertices.weld(makeVertex(corner, attributes)));
+    }
+    chunk.triangleCorners = {};
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "lve_model.hpp"
+
+// std
+#include <string>
+
+namespace lve {
+
+// Multi-threaded OBJ loader for very large models. The file is memory mapped and split into
+// chunks on line boundaries, each chunk's v/vn/vt/f records are parsed on a worker thread, and
+// the results are merged in file order so the output matches a single threaded load.
+//
+// Only geometry records are supported, materials, groups and smoothing groups are ignored.
+class LveObjLoader {
+ public:
+  // files larger than this are loaded with the parallel path by LveModel::createModelFromFile
+  static constexpr size_t PARALLEL_THRESHOLD = 32 * 1024 * 1024;
+
+  LveObjLoader(uint32_t threadCount = 0);
+
+  void load(const std::string &filepath, LveModel::Builder &builder) const;
+
+ private:
+  uint32_t threadCount;
+};
+
+}  // namespace lve
@@ -112,7 +112,7 @@ void LvePipeline::createGraphicsPipeline(
 
   if (vkCreateGraphicsPipelines(
           lveDevice.device(),
-          VK_NULL_HANDLE,
+          lveDevice.pipelineCache(),
           1,
           &pipelineInfo,
           nullptr,
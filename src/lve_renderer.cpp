@@ -11,9 +11,16 @@ LveRenderer::LveRenderer(LveWindow& window, LveDevice& device)
     : lveWindow{window}, lveDevice{device} {
   recreateSwapChain();
   createCommandBuffers();
+  lveDevice.setDeferredDestroyHandler(
+      [this](std::function<void()> destroy) { destroyDeferred(std::move(destroy)); });
 }
 
-LveRenderer::~LveRenderer() { freeCommandBuffers(); }
+LveRenderer::~LveRenderer() {
+  lveDevice.setDeferredDestroyHandler(nullptr);
+  vkDeviceWaitIdle(lveDevice.device());
+  destroyCompleted(true);
+  freeCommandBuffers();
+}
 
 void LveRenderer::recreateSwapChain() {
   auto extent = lveWindow.getExtent();
@@ -62,7 +69,9 @@ void LveRenderer::freeCommandBuffers() {
 VkCommandBuffer LveRenderer::beginFrame() {
   assert(!isFrameStarted && "Can't call beginFrame while already in progress");
 
+  // waits for the fence of the frame that last used this frame's resources
   auto result = lveSwapChain->acquireNextImage(&currentImageIndex);
+  destroyCompleted(false);
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
     recreateSwapChain();
     return nullptr;
@@ -92,6 +101,10 @@ void LveRenderer::endFrame() {
   }
 
   auto result = lveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+  {
+    std::lock_guard<std::mutex> lock{deletionMutex};
+    submittedFrameCount++;
+  }
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
       lveWindow.wasWindowResized()) {
     lveWindow.resetWindowResizedFlag();
@@ -104,6 +117,30 @@ void LveRenderer::endFrame() {
   currentFrameIndex = (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 
+void LveRenderer::destroyDeferred(std::function<void()> destroy) {
+  std::lock_guard<std::mutex> lock{deletionMutex};
+  // frame numbers start at 0, so this is the frame being recorded or the next one
+  deletionQueue.push_back({submittedFrameCount, std::move(destroy)});
+}
+
+void LveRenderer::destroyCompleted(bool all) {
+  std::vector<std::function<void()>> completed;
+  {
+    std::lock_guard<std::mutex> lock{deletionMutex};
+    // the swap chain waits on the fence of the frame MAX_FRAMES_IN_FLIGHT frames back
+    while (!deletionQueue.empty() &&
+           (all || deletionQueue.front().frame + LveSwapChain::MAX_FRAMES_IN_FLIGHT <=
+                       submittedFrameCount)) {
+      completed.push_back(std::move(deletionQueue.front().destroy));
+      deletionQueue.pop_front();
+    }
+  }
+  // destroying may defer more destruction, such as a model releasing its buffers
+  for (auto &destroy : completed) {
+    destroy();
+  }
+}
+
 void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
   assert(
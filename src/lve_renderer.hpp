@@ -6,7 +6,11 @@
 
 // std
 #include <cassert>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace lve {
@@ -37,10 +41,16 @@ class LveRenderer {
   void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+  // Runs destroy once every frame submitted so far, and the one being recorded, has finished on
+  // the GPU. LveDevice::destroyDeferred forwards here while the renderer exists.
+  void destroyDeferred(std::function<void()> destroy);
+
  private:
   void createCommandBuffers();
   void freeCommandBuffers();
   void recreateSwapChain();
+  // runs the deferred destructions of frames whose fence has signaled
+  void destroyCompleted(bool all);
 
   LveWindow &lveWindow;
   LveDevice &lveDevice;
@@ -50,5 +60,13 @@ class LveRenderer {
   uint32_t currentImageIndex;
   int currentFrameIndex{0};
   bool isFrameStarted{false};
+
+  struct DeferredDestroy {
+    uint64_t frame;  // last frame that may use the resource
+    std::function<void()> destroy;
+  };
+  std::mutex deletionMutex;
+  std::deque<DeferredDestroy> deletionQueue;  // in frame order
+  uint64_t submittedFrameCount{0};
 };
 }  // namespace lve
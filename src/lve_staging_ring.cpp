@@ -0,0 +1,122 @@
+#include "lve_staging_ring.hpp"
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+LveStagingRing::LveStagingRing(LveDevice &device, VkDeviceSize size)
+    : lveDevice{device}, size{size} {
+  buffer = std::make_unique<LveBuffer>(
+      lveDevice,
+      size,
+      1,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  buffer->map();
+}
+
+LveStagingRing::~LveStagingRing() {
+  for (auto &entry : entries) {
+    if (entry.submitted && !entry.complete) {
+      vkWaitForFences(lveDevice.device(), 1, &entry.fence, VK_TRUE, UINT64_MAX);
+    }
+  }
+}
+
+bool LveStagingRing::allocate(VkDeviceSize allocSize, VkFence fence, Region &region) {
+  allocSize = (allocSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  if (allocSize > size) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+  while (true) {
+    reclaim();
+
+    // free space is [head, tail) when head < tail, otherwise [head, size) and [0, tail)
+    VkDeviceSize offset = UINT64_MAX;
+    if (entries.empty()) {
+      offset = 0;
+    } else {
+      // head == tail means the ring is full
+      VkDeviceSize tail = entries.front().offset;
+      if (head < tail) {
+        if (tail - head >= allocSize) offset = head;
+      } else if (head > tail) {
+        if (size - head >= allocSize) {
+          offset = head;
+        } else if (tail >= allocSize) {
+          offset = 0;
+        }
+      }
+    }
+
+    if (offset != UINT64_MAX) {
+      VkDeviceSize end = offset + allocSize;
+      // batches reuse their fence, so only extend an entry that was not submitted yet
+      Entry *last = entries.empty() ? nullptr : &entries.back();
+      if (last != nullptr && last->fence == fence && last->end == offset && !last->submitted &&
+          !last->complete) {
+        last->end = end;
+      } else {
+        entries.push_back({offset, end, fence, false, false});
+      }
+      head = end == size ? 0 : end;
+
+      region.buffer = buffer->getBuffer();
+      region.offset = offset;
+      region.size = allocSize;
+      region.mapped = static_cast<char *>(buffer->getMappedMemory()) + offset;
+      return true;
+    }
+
+    // full, wait for the oldest upload unless it has not been submitted yet
+    Entry &oldest = entries.front();
+    if (!oldest.submitted) {
+      return false;
+    }
+    vkWaitForFences(lveDevice.device(), 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+    markComplete(oldest.fence);
+  }
+}
+
+void LveStagingRing::submitted(VkFence fence) {
+  std::lock_guard<std::mutex> lock{mutex};
+  for (auto &entry : entries) {
+    if (entry.fence == fence) entry.submitted = true;
+  }
+}
+
+void LveStagingRing::retire(VkFence fence) {
+  std::lock_guard<std::mutex> lock{mutex};
+  markComplete(fence);
+}
+
+void LveStagingRing::markComplete(VkFence fence) {
+  for (auto &entry : entries) {
+    if (entry.fence == fence) entry.complete = true;
+  }
+}
+
+void LveStagingRing::reclaim() {
+  while (!entries.empty()) {
+    Entry &oldest = entries.front();
+    if (!oldest.complete) {
+      if (!oldest.submitted ||
+          vkGetFenceStatus(lveDevice.device(), oldest.fence) != VK_SUCCESS) {
+        break;
+      }
+      markComplete(oldest.fence);
+    }
+    entries.pop_front();
+  }
+  if (entries.empty()) {
+    head = 0;
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,71 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace lve {
+
+class LveBuffer;
+class LveDevice;
+
+// Persistently mapped host visible buffer that uploads take their staging memory from. Space is
+// handed out in order and reclaimed once the fence of the submission that read it has signaled,
+// so steady state uploads never allocate or map memory.
+class LveStagingRing {
+ public:
+  static constexpr VkDeviceSize DEFAULT_SIZE = 32ull << 20;
+  // offsets satisfy the copy alignment of any texel format
+  static constexpr VkDeviceSize ALIGNMENT = 16;
+
+  struct Region {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;
+  };
+
+  LveStagingRing(LveDevice &device, VkDeviceSize size = DEFAULT_SIZE);
+  ~LveStagingRing();
+
+  LveStagingRing(const LveStagingRing &) = delete;
+  LveStagingRing &operator=(const LveStagingRing &) = delete;
+
+  // Takes size bytes that stay reserved until fence, which guards the submission reading them,
+  // has signaled. Waits for earlier submitted uploads if the ring is full. Returns false if the
+  // space is held by uploads that were not submitted yet, or size exceeds the ring.
+  bool allocate(VkDeviceSize size, VkFence fence, Region &region);
+
+  // fence was submitted, so it is safe to wait on
+  void submitted(VkFence fence);
+  // fence has signaled, or its uploads were abandoned. Call before destroying or resetting it.
+  void retire(VkFence fence);
+
+  VkDeviceSize getSize() const { return size; }
+
+ private:
+  struct Entry {
+    VkDeviceSize offset;
+    VkDeviceSize end;
+    VkFence fence;
+    bool submitted;
+    bool complete;
+  };
+
+  void reclaim();
+  void markComplete(VkFence fence);
+
+  LveDevice &lveDevice;
+  VkDeviceSize size;
+  std::unique_ptr<LveBuffer> buffer;
+
+  std::mutex mutex;
+  std::deque<Entry> entries;  // in allocation order
+  VkDeviceSize head = 0;
+};
+
+}  // namespace lve
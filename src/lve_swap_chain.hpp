@@ -71,7 +71,7 @@ class LveSwapChain {
   VkRenderPass renderPass;
 
   std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
+  std::vector<LveMemoryAllocator::Allocation> depthImageMemorys;
   std::vector<VkImageView> depthImageViews;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
@@ -0,0 +1,336 @@
+#include "lve_upload_batch.hpp"
+
+#include "lve_staging_ring.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+// what the graphics queue may do with uploaded data
+constexpr VkAccessFlags UPLOAD_READ_ACCESS =
+    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+}  // namespace
+
+LveUploadBatch::LveUploadBatch(LveDevice &device)
+    : lveDevice{device}, ownershipTransfer{device.hasDedicatedTransferQueue()} {
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  if (vkCreateFence(lveDevice.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload fence!");
+  }
+
+  beginCommands();
+}
+
+LveUploadBatch::~LveUploadBatch() {
+  if (submitted) {
+    wait();
+  } else {
+    vkEndCommandBuffer(commandBuffer);
+    lveDevice.stagingRing().retire(fence);
+  }
+  vkFreeCommandBuffers(lveDevice.device(), lveDevice.getTransferCommandPool(), 1, &commandBuffer);
+  if (acquireCommandBuffer != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(lveDevice.device(), lveDevice.getCommandPool(), 1, &acquireCommandBuffer);
+  }
+  vkDestroyFence(lveDevice.device(), fence, nullptr);
+}
+
+void LveUploadBatch::copyToBuffer(
+    const void *data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+  assert(!submitted && "Cannot record to an upload batch after it was submitted");
+
+  // a single upload may not hold the whole ring, or it could never overlap with other uploads
+  LveStagingRing &ring = lveDevice.stagingRing();
+  VkDeviceSize maxChunkSize = ring.getSize() / 4;
+
+  const char *bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    VkDeviceSize chunkSize = std::min(size, maxChunkSize);
+    LveStagingRing::Region region{};
+    if (!ring.allocate(chunkSize, fence, region)) {
+      // the ring is held by copies that were not submitted yet, most likely our own
+      flush();
+      if (!ring.allocate(chunkSize, fence, region)) {
+        throw std::runtime_error("failed to allocate staging memory!");
+      }
+    }
+    std::memcpy(region.mapped, bytes, chunkSize);
+    copyBuffer(region.buffer, dstBuffer, chunkSize, region.offset, dstOffset);
+
+    bytes += chunkSize;
+    dstOffset += chunkSize;
+    size -= chunkSize;
+  }
+}
+
+void LveUploadBatch::copyBuffer(
+    VkBuffer srcBuffer,
+    VkBuffer dstBuffer,
+    VkDeviceSize size,
+    VkDeviceSize srcOffset,
+    VkDeviceSize dstOffset) {
+  assert(!submitted && "Cannot record to an upload batch after it was submitted");
+
+  VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = srcOffset;
+  copyRegion.dstOffset = dstOffset;
+  copyRegion.size = size;
+  vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+  copyCount++;
+
+  if (ownershipTransfer) {
+    // extend the previous barrier when copying consecutive chunks
+    if (!bufferBarriers.empty() && bufferBarriers.back().buffer == dstBuffer &&
+        bufferBarriers.back().offset + bufferBarriers.back().size == dstOffset) {
+      bufferBarriers.back().size += size;
+      return;
+    }
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = lveDevice.transferQueueFamily();
+    barrier.dstQueueFamilyIndex = lveDevice.graphicsQueueFamily();
+    barrier.buffer = dstBuffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+    bufferBarriers.push_back(barrier);
+  }
+}
+
+void LveUploadBatch::copyBufferToImage(
+    VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
+  assert(!submitted && "Cannot record to an upload batch after it was submitted");
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = layerCount;
+
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {width, height, 1};
+
+  vkCmdCopyBufferToImage(
+      commandBuffer,
+      buffer,
+      image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1,
+      &region);
+  copyCount++;
+
+  if (ownershipTransfer) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = lveDevice.transferQueueFamily();
+    barrier.dstQueueFamilyIndex = lveDevice.graphicsQueueFamily();
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layerCount;
+    imageBarriers.push_back(barrier);
+  }
+}
+
+void LveUploadBatch::submit() {
+  assert(!submitted && "Upload batch was already submitted");
+  submitCommands();
+  submitted = true;
+}
+
+bool LveUploadBatch::isComplete() {
+  update(false);
+  return complete;
+}
+
+void LveUploadBatch::wait() { update(true); }
+
+void LveUploadBatch::update(bool block) {
+  if (!submitted || complete) {
+    return;
+  }
+
+  if (!copiesComplete) {
+    if (block) {
+      vkWaitForFences(lveDevice.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+    } else if (vkGetFenceStatus(lveDevice.device(), fence) != VK_SUCCESS) {
+      return;
+    }
+    lveDevice.stagingRing().retire(fence);
+    copiesComplete = true;
+
+    if (bufferBarriers.empty() && imageBarriers.empty()) {
+      complete = true;
+      return;
+    }
+    vkResetFences(lveDevice.device(), 1, &fence);
+    submitAcquire();
+  }
+
+  if (block) {
+    vkWaitForFences(lveDevice.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+  } else if (vkGetFenceStatus(lveDevice.device(), fence) != VK_SUCCESS) {
+    return;
+  }
+  complete = true;
+}
+
+void LveUploadBatch::beginCommands() {
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = lveDevice.getTransferCommandPool();
+  allocInfo.commandBufferCount = 1;
+  if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate upload command buffer!");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+  // copies may overwrite buffer ranges that earlier submissions to the same queue still read, such
+  // as freed ranges of a geometry buffer. Frames on the graphics queue are covered by deferring
+  // frees until their fences signal, see LveRenderer::destroyDeferred
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      0,
+      nullptr);
+}
+
+void LveUploadBatch::submitCommands() {
+  if (ownershipTransfer) {
+    // release, the matching acquire is recorded by submitAcquire
+    for (auto &barrier : bufferBarriers) {
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = 0;
+    }
+    for (auto &barrier : imageBarriers) {
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = 0;
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()),
+        bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()),
+        imageBarriers.data());
+  } else {
+    // make the copies visible to any later use of the buffers on this queue
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+  }
+
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record upload command buffer!");
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  if (vkQueueSubmit(lveDevice.transferQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload command buffer!");
+  }
+  lveDevice.stagingRing().submitted(fence);
+}
+
+void LveUploadBatch::submitAcquire() {
+  for (auto &barrier : bufferBarriers) {
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+  }
+  for (auto &barrier : imageBarriers) {
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+  }
+
+  if (acquireCommandBuffer != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(lveDevice.device(), lveDevice.getCommandPool(), 1, &acquireCommandBuffer);
+  }
+  acquireCommandBuffer = lveDevice.beginSingleTimeCommands();
+  // later submissions to the graphics queue are ordered after this barrier
+  vkCmdPipelineBarrier(
+      acquireCommandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(bufferBarriers.size()),
+      bufferBarriers.data(),
+      static_cast<uint32_t>(imageBarriers.size()),
+      imageBarriers.data());
+  bufferBarriers.clear();
+  imageBarriers.clear();
+
+  if (vkEndCommandBuffer(acquireCommandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record upload acquire command buffer!");
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &acquireCommandBuffer;
+  if (vkQueueSubmit(lveDevice.graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload acquire command buffer!");
+  }
+}
+
+void LveUploadBatch::flush() {
+  submitted = true;
+  submitCommands();
+  wait();
+
+  vkResetFences(lveDevice.device(), 1, &fence);
+  vkFreeCommandBuffers(lveDevice.device(), lveDevice.getTransferCommandPool(), 1, &commandBuffer);
+  submitted = false;
+  copiesComplete = false;
+  complete = false;
+  beginCommands();
+}
+
+}  // namespace lve
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std
+#include <vector>
+
+namespace lve {
+
+// Records many buffer uploads into one command buffer that is submitted with a fence, so the CPU
+// never waits on the queue. Data is staged in the device's LveStagingRing, whose space is reclaimed
+// once the fence signals. Uploads larger than the ring are split, and a batch that runs out of ring
+// space executes the copies recorded so far before continuing.
+//
+// Batches run on the device's dedicated transfer queue when it has one, so uploads overlap with
+// rendering. Ownership of the written resources is then released to the graphics family, and
+// acquired again by a small graphics submission once the copies have finished.
+class LveUploadBatch {
+ public:
+  LveUploadBatch(LveDevice &device);
+  ~LveUploadBatch();
+
+  LveUploadBatch(const LveUploadBatch &) = delete;
+  LveUploadBatch &operator=(const LveUploadBatch &) = delete;
+
+  // Stages size bytes of data now and copies them to dstBuffer when the batch executes
+  void copyToBuffer(
+      const void *data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+  // Device side copies, ordered with the other copies of the batch
+  void copyBuffer(
+      VkBuffer srcBuffer,
+      VkBuffer dstBuffer,
+      VkDeviceSize size,
+      VkDeviceSize srcOffset = 0,
+      VkDeviceSize dstOffset = 0);
+  // image must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL when the batch executes and stays in it
+  void copyBufferToImage(
+      VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
+
+  // Submits the recorded copies, the batch cannot be recorded to afterwards
+  void submit();
+  bool isSubmitted() const { return submitted; }
+  // nothing was recorded, such as when every buffer was written directly
+  bool isEmpty() const { return copyCount == 0; }
+  // Non blocking, true once the copies have executed and the graphics queue may use the results
+  bool isComplete();
+  // Only needed before the CPU reads or frees what the copies wrote, or when the results are used
+  // on the graphics queue without checking isComplete()
+  void wait();
+
+ private:
+  void beginCommands();
+  void submitCommands();
+  // graphics side of the queue family ownership transfer
+  void submitAcquire();
+  void update(bool block);
+  // executes everything recorded so far and starts a new command buffer
+  void flush();
+
+  LveDevice &lveDevice;
+  bool ownershipTransfer;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+  VkFence fence = VK_NULL_HANDLE;
+  bool submitted = false;
+  bool copiesComplete = false;
+  bool complete = false;
+  uint32_t copyCount = 0;
+
+  // regions written by the copies, to transfer to the graphics family
+  std::vector<VkBufferMemoryBarrier> bufferBarriers;
+  std::vector<VkImageMemoryBarrier> imageBarriers;
+};
+
+}  // namespace lve
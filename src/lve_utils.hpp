@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace lve {
@@ -11,4 +13,37 @@ void hashCombine(std::size_t& seed, const T& v, const Rest&... rest) {
   (hashCombine(seed, rest), ...);
 };
 
+// Fast non-cryptographic 64 bit hash over raw bytes, consumes 8 bytes per step
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+  constexpr uint64_t prime1 = 0x9e3779b97f4a7c15ull;
+  constexpr uint64_t prime2 = 0xbf58476d1ce4e5b9ull;
+
+  auto mix = [](uint64_t k) {
+    k *= prime2;
+    k ^= k >> 31;
+    return k * prime1;
+  };
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  uint64_t hash = seed ^ (size * prime1);
+  while (size >= 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes, 8);
+    hash = (hash ^ mix(word)) * prime1;
+    hash ^= hash >> 29;
+    bytes += 8;
+    size -= 8;
+  }
+  if (size > 0) {
+    uint64_t word = 0;
+    std::memcpy(&word, bytes, size);
+    hash = (hash ^ mix(word)) * prime1;
+  }
+
+  hash ^= hash >> 32;
+  hash *= prime2;
+  hash ^= hash >> 29;
+  return hash;
+}
+
 }  // namespace lve
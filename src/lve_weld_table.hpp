@@ -0,0 +1,118 @@
+#pragma once
+
+#include "lve_utils.hpp"
+
+// std
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace lve {
+
+// Flat open-addressing table used to weld duplicate vertices while building an index buffer.
+//
+// Vertices are compared bitwise and hashed with hashBytes over their raw bytes, so T must be a
+// trivially copyable struct made only of floats (such as LveModel::Vertex). -0 is treated as 0.
+// With a non zero epsilon every component is snapped to a grid of that size before comparing,
+// which also welds vertices that differ only by float noise.
+template <typename T>
+class LveWeldTable {
+ public:
+  static_assert(
+      std::is_trivially_copyable<T>::value && sizeof(T) % sizeof(float) == 0,
+      "LveWeldTable requires a trivially copyable vertex made of floats");
+
+  // Unique vertices are appended to vertices, which should be empty. expectedCount is the
+  // expected number of unique vertices, the table grows if it is exceeded.
+  LveWeldTable(std::vector<T> &vertices, size_t expectedCount = 0, float epsilon = 0.f)
+      : vertices{vertices}, epsilon{epsilon} {
+    size_t capacity = 16;
+    while (capacity * 3 < expectedCount * 4) capacity *= 2;
+    slots.assign(capacity, EMPTY);
+    hashes.resize(capacity);
+    vertices.reserve(expectedCount);
+  }
+
+  LveWeldTable(const LveWeldTable &) = delete;
+  LveWeldTable &operator=(const LveWeldTable &) = delete;
+
+  // Returns the index of vertex in vertices, appending it if no matching vertex exists yet
+  uint32_t weld(const T &vertex) {
+    Key key = makeKey(vertex);
+    uint32_t hash = static_cast<uint32_t>(hashBytes(&key, sizeof(Key)));
+
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+      uint32_t index = slots[slot];
+      if (index == EMPTY) {
+        index = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(vertex);
+        slots[slot] = index;
+        hashes[slot] = hash;
+        if (++count * 4 > slots.size() * 3) {
+          grow();
+        }
+        return index;
+      }
+      if (hashes[slot] == hash && matches(key, vertices[index])) {
+        return index;
+      }
+    }
+  }
+
+  size_t size() const { return count; }
+
+ private:
+  static constexpr uint32_t EMPTY = UINT32_MAX;
+  static constexpr size_t COMPONENT_COUNT = sizeof(T) / sizeof(float);
+
+  struct Key {
+    float components[COMPONENT_COUNT];
+  };
+
+  Key makeKey(const T &vertex) const {
+    Key key;
+    std::memcpy(&key, &vertex, sizeof(Key));
+    for (float &component : key.components) {
+      if (epsilon > 0.f) {
+        component = std::round(component / epsilon) * epsilon;
+      }
+      if (component == 0.f) {
+        component = 0.f;  // -0 and 0 must hash the same
+      }
+    }
+    return key;
+  }
+
+  bool matches(const Key &key, const T &vertex) const {
+    Key other = makeKey(vertex);
+    return std::memcmp(&key, &other, sizeof(Key)) == 0;
+  }
+
+  void grow() {
+    std::vector<uint32_t> oldSlots(slots.size() * 2, EMPTY);
+    std::vector<uint32_t> oldHashes(hashes.size() * 2);
+    oldSlots.swap(slots);
+    oldHashes.swap(hashes);
+
+    size_t mask = slots.size() - 1;
+    for (size_t i = 0; i < oldSlots.size(); i++) {
+      if (oldSlots[i] == EMPTY) continue;
+      size_t slot = oldHashes[i] & mask;
+      while (slots[slot] != EMPTY) slot = (slot + 1) & mask;
+      slots[slot] = oldSlots[i];
+      hashes[slot] = oldHashes[i];
+    }
+  }
+
+  std::vector<T> &vertices;
+  float epsilon;
+  size_t count = 0;
+
+  std::vector<uint32_t> slots;   // index into vertices, or EMPTY
+  std::vector<uint32_t> hashes;  // hash of the vertex in each slot, skips most key compares
+};
+
+}  // namespace lve
@@ -7,9 +7,12 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
+#include <string>
 
 namespace lve {
 
@@ -18,17 +21,72 @@ struct SimplePushConstantData {
   glm::mat4 normalMatrix{1.f};
 };
 
+// matches ObjectData in the bindless shaders
+struct BindlessObjectData {
+  glm::mat4 modelMatrix{1.f};
+  glm::mat4 normalMatrix{1.f};
+  uint32_t textureIndex = LveBindlessDescriptors::INVALID_INDEX;
+  uint32_t padding[3];
+};
+
+struct BindlessPushConstantData {
+  uint32_t objectIndex = 0;
+  uint32_t objectBufferIndex = 0;
+};
+
 SimpleRenderSystem::SimpleRenderSystem(
-    LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-    : lveDevice{device} {
+    LveDevice& device,
+    VkRenderPass renderPass,
+    VkDescriptorSetLayout globalSetLayout,
+    LveBindlessDescriptors* bindlessDescriptors)
+    : lveDevice{device}, bindlessDescriptors{bindlessDescriptors} {
   createPipelineLayout(globalSetLayout);
   createPipeline(renderPass);
+  if (bindlessDescriptors != nullptr) {
+    createObjectBuffers();
+  }
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
+  for (uint32_t index : objectBufferIndices) {
+    bindlessDescriptors->removeStorageBuffer(index);
+  }
   vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
 }
 
+void SimpleRenderSystem::createObjectBuffers() {
+  objectBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  objectBufferIndices.resize(
+      LveSwapChain::MAX_FRAMES_IN_FLIGHT,
+      LveBindlessDescriptors::INVALID_INDEX);
+  for (int i = 0; i < LveSwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+    resizeObjectBuffer(i, INITIAL_BINDLESS_OBJECTS);
+  }
+}
+
+// The previous buffer and its array index are released once frames in flight are done with them
+void SimpleRenderSystem::resizeObjectBuffer(int frameIndex, uint32_t objectCount) {
+  VkDeviceSize bufferSize = sizeof(BindlessObjectData) * objectCount;
+  // written by the host every frame and read by the device once
+  VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  if (lveDevice.prefersDirectWrite(bufferSize)) {
+    memoryProperties |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  }
+
+  auto buffer = std::make_unique<LveBuffer>(
+      lveDevice,
+      sizeof(BindlessObjectData),
+      objectCount,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      memoryProperties);
+  buffer->map();
+  if (objectBufferIndices[frameIndex] != LveBindlessDescriptors::INVALID_INDEX) {
+    bindlessDescriptors->removeStorageBuffer(objectBufferIndices[frameIndex]);
+  }
+  objectBufferIndices[frameIndex] = bindlessDescriptors->addStorageBuffer(buffer->descriptorInfo());
+  objectBuffers[frameIndex] = std::move(buffer);
+}
+
 void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
   VkPushConstantRange pushConstantRange{};
   pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -36,6 +94,11 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLay
   pushConstantRange.size = sizeof(SimplePushConstantData);
 
   std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+  if (bindlessDescriptors != nullptr) {
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.size = sizeof(BindlessPushConstantData);
+    descriptorSetLayouts.push_back(bindlessDescriptors->getDescriptorSetLayout());
+  }
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -56,15 +119,35 @@ void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
   LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
+  bool bindless = bindlessDescriptors != nullptr;
+  std::string fragFilepath =
+      bindless ? "shaders/simple_shader_bindless.frag.spv" : "shaders/simple_shader.frag.spv";
   lvePipeline = std::make_unique<LvePipeline>(
       lveDevice,
-      "shaders/simple_shader.vert.spv",
-      "shaders/simple_shader.frag.spv",
+      bindless ? "shaders/simple_shader_bindless.vert.spv" : "shaders/simple_shader.vert.spv",
+      fragFilepath,
       pipelineConfig);
+
+  // culling meshlets by normal cone would remove visible back faces unless the pipeline culls them
+  meshletConeCulling = (pipelineConfig.rasterizationInfo.cullMode & VK_CULL_MODE_BACK_BIT) != 0;
+
+  PipelineConfigInfo compactPipelineConfig{};
+  LvePipeline::defaultPipelineConfigInfo(compactPipelineConfig);
+  compactPipelineConfig.bindingDescriptions = LveModel::CompactVertex::getBindingDescriptions();
+  compactPipelineConfig.attributeDescriptions = LveModel::CompactVertex::getAttributeDescriptions();
+  compactPipelineConfig.renderPass = renderPass;
+  compactPipelineConfig.pipelineLayout = pipelineLayout;
+  compactPipeline = std::make_unique<LvePipeline>(
+      lveDevice,
+      bindless ? "shaders/simple_shader_compact_bindless.vert.spv"
+               : "shaders/simple_shader_compact.vert.spv",
+      fragFilepath,
+      compactPipelineConfig);
 }
 
 void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
-  lvePipeline->bind(frameInfo.commandBuffer);
+  LvePipeline* boundPipeline = lvePipeline.get();
+  boundPipeline->bind(frameInfo.commandBuffer);
 
   vkCmdBindDescriptorSets(
       frameInfo.commandBuffer,
@@ -73,25 +156,112 @@ void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
       0,
       1,
       &frameInfo.globalDescriptorSet,
-      0,
-      nullptr);
+      1,
+      &frameInfo.globalUboOffset);
 
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.model == nullptr) continue;
-    SimplePushConstantData push{};
-    push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
+  // objects select their data and textures by index, nothing is rebound per object
+  BindlessObjectData* objectData = nullptr;
+  uint32_t objectCount = 0;
+  if (bindlessDescriptors != nullptr) {
+    // grown before the set is bound, other frames in flight never read the new array index
+    uint32_t drawCount = static_cast<uint32_t>(std::count_if(
+        frameInfo.gameObjects.begin(),
+        frameInfo.gameObjects.end(),
+        [](const auto& kv) { return kv.second.model != nullptr; }));
+    uint32_t capacity = objectBuffers[frameInfo.frameIndex]->getInstanceCount();
+    if (drawCount > capacity) {
+      resizeObjectBuffer(frameInfo.frameIndex, std::max(drawCount, capacity * 2));
+    }
 
-    vkCmdPushConstants(
+    VkDescriptorSet bindlessSet = bindlessDescriptors->getDescriptorSet();
+    vkCmdBindDescriptorSets(
         frameInfo.commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        1,
+        1,
+        &bindlessSet,
         0,
-        sizeof(SimplePushConstantData),
-        &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
+        nullptr);
+    objectData =
+        static_cast<BindlessObjectData*>(objectBuffers[frameInfo.frameIndex]->getMappedMemory());
+  }
+
+  // projection[1][1] is 1 / tan(fovy / 2) for a perspective projection
+  glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+  float projectionScale = std::abs(frameInfo.camera.getProjection()[1][1]);
+  glm::mat4 projectionView = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+
+  // models sharing a geometry buffer are only bound once
+  VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+  for (auto& kv : frameInfo.gameObjects) {
+    auto& obj = kv.second;
+    if (obj.model == nullptr) continue;
+
+    glm::vec3 scale = glm::abs(obj.transform.scale);
+    float maxScale = std::max(scale.x, std::max(scale.y, scale.z));
+    float distance = std::max(glm::length(obj.transform.translation - cameraPosition), 1e-4f);
+    obj.modelLod = obj.model->selectLod(maxScale * projectionScale / distance, obj.modelLod);
+
+    LvePipeline* pipeline = obj.model->getVertexFormat() == LveModel::VERTEX_FORMAT_COMPACT
+                                ? compactPipeline.get()
+                                : lvePipeline.get();
+    if (pipeline != boundPipeline) {
+      pipeline->bind(frameInfo.commandBuffer);
+      boundPipeline = pipeline;
+    }
+
+    glm::mat4 modelMatrix = obj.transform.mat4();
+    if (objectData != nullptr) {
+      BindlessObjectData& data = objectData[objectCount];
+      data.modelMatrix = modelMatrix * obj.model->getDequantizeMatrix();
+      data.normalMatrix = obj.transform.normalMatrix();
+      data.textureIndex = obj.textureIndex;
+
+      BindlessPushConstantData push{};
+      push.objectIndex = objectCount++;
+      push.objectBufferIndex = objectBufferIndices[frameInfo.frameIndex];
+      vkCmdPushConstants(
+          frameInfo.commandBuffer,
+          pipelineLayout,
+          VK_SHADER_STAGE_VERTEX_BIT,
+          0,
+          sizeof(BindlessPushConstantData),
+          &push);
+    } else {
+      SimplePushConstantData push{};
+      push.modelMatrix = modelMatrix * obj.model->getDequantizeMatrix();
+      push.normalMatrix = obj.transform.normalMatrix();
+
+      vkCmdPushConstants(
+          frameInfo.commandBuffer,
+          pipelineLayout,
+          VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+          0,
+          sizeof(SimplePushConstantData),
+          &push);
+    }
+    if (obj.model->getVertexBuffer() != boundVertexBuffer) {
+      obj.model->bind(frameInfo.commandBuffer);
+      boundVertexBuffer = obj.model->getVertexBuffer();
+    }
+
+    if (obj.modelLod == 0 && obj.model->getMeshletCount() > 0) {
+      // normal cones do not survive non uniform scaling
+      bool uniformScale = scale.x == scale.y && scale.y == scale.z;
+      glm::vec3 objectCameraPosition{glm::inverse(modelMatrix) * glm::vec4{cameraPosition, 1.f}};
+      obj.model->drawVisibleMeshlets(
+          frameInfo.commandBuffer,
+          projectionView * modelMatrix,
+          objectCameraPosition,
+          meshletConeCulling && uniformScale);
+    } else {
+      obj.model->draw(frameInfo.commandBuffer, obj.modelLod);
+    }
+  }
+
+  if (objectCount > 0) {
+    objectBuffers[frameInfo.frameIndex]->flush(objectCount * sizeof(BindlessObjectData));
   }
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "lve_bindless_descriptors.hpp"
+#include "lve_buffer.hpp"
 #include "lve_camera.hpp"
 #include "lve_device.hpp"
 #include "lve_frame_info.hpp"
@@ -13,8 +15,17 @@
 namespace lve {
 class SimpleRenderSystem {
  public:
+  // objects the per frame buffers hold at first when bindless descriptors are used, they grow to
+  // fit every object drawn in a frame
+  static constexpr uint32_t INITIAL_BINDLESS_OBJECTS = 16384;
+
+  // With bindless descriptors, per object data is read from a storage buffer indexed by a small
+  // push constant, and objects may sample a texture by index
   SimpleRenderSystem(
-      LveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+      LveDevice &device,
+      VkRenderPass renderPass,
+      VkDescriptorSetLayout globalSetLayout,
+      LveBindlessDescriptors *bindlessDescriptors = nullptr);
   ~SimpleRenderSystem();
 
   SimpleRenderSystem(const SimpleRenderSystem &) = delete;
@@ -25,10 +36,18 @@ class SimpleRenderSystem {
  private:
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
   void createPipeline(VkRenderPass renderPass);
+  void createObjectBuffers();
+  void resizeObjectBuffer(int frameIndex, uint32_t objectCount);
 
   LveDevice &lveDevice;
+  LveBindlessDescriptors *bindlessDescriptors;
+  // per frame in flight, and their indices in the bindless storage buffer array
+  std::vector<std::unique_ptr<LveBuffer>> objectBuffers;
+  std::vector<uint32_t> objectBufferIndices;
 
   std::unique_ptr<LvePipeline> lvePipeline;
+  std::unique_ptr<LvePipeline> compactPipeline;  // for LveModel::VERTEX_FORMAT_COMPACT models
   VkPipelineLayout pipelineLayout;
+  bool meshletConeCulling = false;
 };
 }  // namespace lve